@@ -0,0 +1,269 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "GrapholonTypes.hpp"
+
+namespace grapholon {
+
+	/** A small LZ77 compressor in the spirit of LZ4 : fast, no entropy coding, 64KB window.
+	A compressed stream is made of
+	 - the magic string "GRLZ" and a 32 bits version
+	 - blocks of at most LZ_MAX_BLOCK_SIZE bytes, each starting with its raw size and stored size (32 bits each).
+	   A block whose stored size equals its raw size could not be compressed and is stored as is
+	 - an empty block (raw size 0) marking the end of the stream
+	All 32 bits values are little-endian.
+	Each compressed block is a sequence of (literals, match) pairs, each starting with a token byte :
+	4 bits of literal length and 4 bits of match length minus 4 (15 means that more length bytes follow).
+	The last pair of a block only has literals*/
+
+#define LZ_STREAM_MAGIC "GRLZ"
+#define LZ_STREAM_VERSION 1
+#define LZ_HASH_BITS 16
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_MAX_BLOCK_SIZE (1 << 20)
+
+	namespace lz_detail {
+		inline std::uint32_t read_u32(const char* data) {
+			const unsigned char* bytes = (const unsigned char*)data;
+			return (std::uint32_t)bytes[0] | ((std::uint32_t)bytes[1] << 8) | ((std::uint32_t)bytes[2] << 16) | ((std::uint32_t)bytes[3] << 24);
+		}
+
+		inline void write_u32(char* data, std::uint32_t value) {
+			for (GRuint i(0); i < 4; i++) {
+				data[i] = (char)((value >> (8 * i)) & 0xFF);
+			}
+		}
+
+		inline void append_u32(std::vector<char>& output, std::uint32_t value) {
+			char bytes[4];
+			write_u32(bytes, value);
+			output.insert(output.end(), bytes, bytes + 4);
+		}
+
+		inline void append_length(std::vector<char>& output, size_t length) {
+			while (length >= 255) {
+				output.push_back((char)255);
+				length -= 255;
+			}
+			output.push_back((char)length);
+		}
+
+		inline GRuint hash(std::uint32_t sequence) {
+			return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+		}
+	}
+
+	/** Appends the compressed form of the block to 'output'*/
+	inline void lz_compress_block(const char* input, size_t size, std::vector<char>& output) {
+		using namespace lz_detail;
+
+		std::vector<std::uint32_t> table((size_t)1 << LZ_HASH_BITS, 0);
+		size_t literal_start(0);
+		size_t position(0);
+
+		auto emit = [&](size_t literal_end, size_t match_length, size_t offset) {
+			size_t literal_length = literal_end - literal_start;
+			char token = (char)(((literal_length < 15 ? literal_length : 15) << 4)
+				| (match_length ? (match_length - LZ_MIN_MATCH < 15 ? match_length - LZ_MIN_MATCH : 15) : 0));
+			output.push_back(token);
+			if (literal_length >= 15) {
+				append_length(output, literal_length - 15);
+			}
+			output.insert(output.end(), input + literal_start, input + literal_end);
+			if (match_length) {
+				output.push_back((char)(offset & 0xFF));
+				output.push_back((char)(offset >> 8));
+				if (match_length - LZ_MIN_MATCH >= 15) {
+					append_length(output, match_length - LZ_MIN_MATCH - 15);
+				}
+			}
+		};
+
+		while (size >= LZ_MIN_MATCH && position + LZ_MIN_MATCH <= size) {
+			std::uint32_t sequence = read_u32(input + position);
+			GRuint slot = hash(sequence);
+			size_t candidate = table[slot];
+			table[slot] = (std::uint32_t)position;
+
+			if (candidate < position
+				&& position - candidate <= LZ_MAX_OFFSET
+				&& read_u32(input + candidate) == sequence) {
+
+				size_t match_length = LZ_MIN_MATCH;
+				while (position + match_length < size && input[candidate + match_length] == input[position + match_length]) {
+					match_length++;
+				}
+
+				emit(position, match_length, position - candidate);
+				position += match_length;
+				literal_start = position;
+			}
+			else {
+				position++;
+			}
+		}
+
+		//the remaining bytes are literals
+		emit(size, 0, 0);
+	}
+
+	/** Returns false if the compressed block is corrupted or doesn't decompress to exactly 'output_size' bytes*/
+	inline bool lz_decompress_block(const char* input, size_t size, char* output, size_t output_size) {
+		const unsigned char* in = (const unsigned char*)input;
+		const unsigned char* in_end = in + size;
+		size_t written(0);
+
+		auto read_length = [&](size_t& length) {
+			unsigned char byte;
+			do {
+				if (in == in_end) {
+					return false;
+				}
+				byte = *in++;
+				length += byte;
+			} while (byte == 255);
+			return true;
+		};
+
+		while (in < in_end) {
+			unsigned char token = *in++;
+
+			size_t literal_length = token >> 4;
+			if (literal_length == 15 && !read_length(literal_length)) {
+				return false;
+			}
+			if ((size_t)(in_end - in) < literal_length || output_size - written < literal_length) {
+				return false;
+			}
+			std::memcpy(output + written, in, literal_length);
+			in += literal_length;
+			written += literal_length;
+
+			//the last sequence has no match
+			if (in == in_end) {
+				break;
+			}
+
+			if (in_end - in < 2) {
+				return false;
+			}
+			size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+			in += 2;
+			size_t match_length = (token & 0x0F);
+			if (match_length == 15 && !read_length(match_length)) {
+				return false;
+			}
+			match_length += LZ_MIN_MATCH;
+
+			if (offset == 0 || offset > written || output_size - written < match_length) {
+				return false;
+			}
+			//byte by byte since the match may overlap what it writes
+			const char* match = output + written - offset;
+			for (size_t i(0); i < match_length; i++) {
+				output[written + i] = match[i];
+			}
+			written += match_length;
+		}
+
+		return written == output_size;
+	}
+
+	inline bool is_lz_stream(const char* data, size_t size) {
+		return size >= 8 && std::memcmp(data, LZ_STREAM_MAGIC, 4) == 0;
+	}
+
+	inline void lz_begin_stream(std::vector<char>& output) {
+		output.insert(output.end(), LZ_STREAM_MAGIC, LZ_STREAM_MAGIC + 4);
+		lz_detail::append_u32(output, LZ_STREAM_VERSION);
+	}
+
+	/** Appends framed blocks to the stream (several if size is more than LZ_MAX_BLOCK_SIZE)*/
+	inline void lz_append_block(const char* input, size_t size, std::vector<char>& output) {
+		while (size > LZ_MAX_BLOCK_SIZE) {
+			lz_append_block(input, LZ_MAX_BLOCK_SIZE, output);
+			input += LZ_MAX_BLOCK_SIZE;
+			size -= LZ_MAX_BLOCK_SIZE;
+		}
+
+		size_t header_position = output.size();
+		lz_detail::append_u32(output, (std::uint32_t)size);
+		lz_detail::append_u32(output, 0);
+
+		size_t data_position = output.size();
+		lz_compress_block(input, size, output);
+		size_t stored_size = output.size() - data_position;
+
+		if (stored_size >= size) {
+			output.resize(data_position);
+			output.insert(output.end(), input, input + size);
+			stored_size = size;
+		}
+		lz_detail::write_u32(&output[header_position + 4], (std::uint32_t)stored_size);
+	}
+
+	inline void lz_end_stream(std::vector<char>& output) {
+		lz_detail::append_u32(output, 0);
+		lz_detail::append_u32(output, 0);
+	}
+
+	/** Decompresses a whole stream. Returns false if it is not a valid stream*/
+	inline bool lz_decompress_stream(const char* data, size_t size, std::vector<char>& output) {
+		using namespace lz_detail;
+
+		if (!is_lz_stream(data, size) || read_u32(data + 4) != LZ_STREAM_VERSION) {
+			return false;
+		}
+
+		size_t position(8);
+		while (true) {
+			if (size - position < 8) {
+				return false;
+			}
+			std::uint32_t raw_size = read_u32(data + position);
+			std::uint32_t stored_size = read_u32(data + position + 4);
+			position += 8;
+			if (!raw_size) {
+				return true;
+			}
+			if (raw_size > LZ_MAX_BLOCK_SIZE || size - position < stored_size || stored_size > raw_size) {
+				return false;
+			}
+
+			size_t output_position = output.size();
+			output.resize(output_position + raw_size);
+			if (stored_size == raw_size) {
+				std::memcpy(&output[output_position], data + position, raw_size);
+			}
+			else if (!lz_decompress_block(data + position, stored_size, &output[output_position], raw_size)) {
+				return false;
+			}
+			position += stored_size;
+		}
+	}
+}
@@ -21,7 +21,15 @@
 //
 #pragma once
 
+#include <algorithm>
+#include <cfloat>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
 #include "Vector.hpp"
+#include "CurveKernels.hpp"
+#include "Parallel.hpp"
 
 namespace grapholon {
 
@@ -43,6 +51,29 @@ namespace grapholon {
 
 	typedef std::pair<Vector3f, Vector3f> PointTangent;
 
+#define SPLINE_RESAMPLING_MAX_DEPTH 16
+#define SPLINE_ARC_LENGTH_SAMPLES 16
+
+	/** Cubic Hermite segment in power basis : p(u) = a + u (b + u (c + u d)), u in [0, 1]*/
+	struct HermiteSegment {
+		Vector3f a, b, c, d;
+
+		HermiteSegment() {}
+
+		HermiteSegment(const Vector3f& start, const Vector3f& start_tangent, const Vector3f& end, const Vector3f& end_tangent)
+			: a(start), b(start_tangent),
+			c((end - start) * 3.f - start_tangent * 2.f - end_tangent),
+			d((start - end) * 2.f + start_tangent + end_tangent) {}
+
+		Vector3f position(GRfloat u) const {
+			return a + (b + (c + d * u) * u) * u;
+		}
+
+		Vector3f derivative(GRfloat u) const {
+			return b + (c * 2.f + d * (3.f * u)) * u;
+		}
+	};
+
 
 	/** A SplineCurve is a sequence of points and tangents defining a piece-wise spline... curve
 	It inherits from STL's vector<> template to allow to use all of vector's interface.
@@ -71,7 +102,7 @@ namespace grapholon {
 
 		SplineCurve(std::vector<Vector3f> points) {
 			if (points.size() < 2) {
-				std::cerr << "Cannot create spine curve with less than two points" << std::endl;
+				GR_LOG_WARNING("Cannot create spine curve with less than two points");
 				(*this) = SplineCurve();
 			}
 			for (auto point : points) {
@@ -152,6 +183,154 @@ namespace grapholon {
 			}
 		}
 
+
+		/************************************************************************************************ Evaluation */
+
+		/** Hermite segment between the points segment_index and segment_index + 1. The stored tangents are only used
+		as directions : they are normalized and scaled by the segment's length, so the curve is the same whether they
+		are normalized or not. A null tangent is replaced by the segment's direction.
+		Throws a std::invalid_argument if there is no such segment*/
+		HermiteSegment segment(GRuint segment_index) const {
+			if ((size_t)segment_index + 1 >= size()) {
+				throw std::invalid_argument("SplineCurve segment index out of range");
+			}
+			const PointTangent& start = (*this)[segment_index];
+			const PointTangent& end = (*this)[segment_index + 1];
+			Vector3f chord = end.first - start.first;
+			GRfloat chord_length = chord.norm();
+			Vector3f start_tangent = start.second.norm() > FLT_EPSILON ? start.second.normalized() * chord_length : chord;
+			Vector3f end_tangent = end.second.norm() > FLT_EPSILON ? end.second.normalized() * chord_length : chord;
+			return HermiteSegment(start.first, start_tangent, end.first, end_tangent);
+		}
+
+		/** Splits the curve's parameter t (in [0, 1], each segment having the same range) into a segment index
+		and the parameter u in [0, 1] inside that segment.
+		The evaluation functions throw a std::invalid_argument if the curve has less than two points*/
+		GRuint segment_parameter(GRfloat t, GRfloat& u) const {
+			if (size() < 2) {
+				throw std::invalid_argument("Cannot evaluate a SplineCurve with less than two points");
+			}
+			GRuint segment_count = (GRuint)size() - 1;
+			GRfloat position = MAX(0.f, MIN(t, 1.f)) * (GRfloat)segment_count;
+			GRuint segment_index = MIN((GRuint)position, segment_count - 1);
+			u = position - (GRfloat)segment_index;
+			return segment_index;
+		}
+
+		/** Point of the curve at parameter t in [0, 1]. The points of the curve are at t = i / (size() - 1)*/
+		Vector3f evaluate(GRfloat t) const {
+			GRfloat u;
+			GRuint segment_index = segment_parameter(t, u);
+			return segment(segment_index).position(u);
+		}
+
+		/** Derivative of the curve with respect to t at parameter t in [0, 1] (not normalized)*/
+		Vector3f evaluate_tangent(GRfloat t) const {
+			GRfloat u;
+			GRuint segment_index = segment_parameter(t, u);
+			return segment(segment_index).derivative(u) * (GRfloat)(size() - 1);
+		}
+
+		/** Evaluates the curve at all the given parameters (see evaluate()). The segments are built once for the
+		whole batch and stored as arrays of coefficients, which curve_kernels::cubic_evaluate() evaluates 8 samples
+		at a time when compiled with AVX2. If tangents is not null, the normalized tangents are stored in it too*/
+		void sample(const std::vector<GRfloat>& parameters, std::vector<Vector3f>& points, std::vector<Vector3f>* tangents = nullptr) const {
+			GRuint sample_count = (GRuint)parameters.size();
+			std::vector<std::int32_t> segment_indices(sample_count);
+			std::vector<GRfloat> u(sample_count);
+			for (GRuint i(0); i < sample_count; i++) {
+				segment_indices[i] = (std::int32_t)segment_parameter(parameters[i], u[i]);
+			}
+
+			//coefficient k of coordinate c of segment s is at (4 * c + k) * segment_count + s
+			GRuint segment_count = (GRuint)size() - 1;
+			std::vector<GRfloat> coefficient_values(12 * (size_t)segment_count);
+			const GRfloat* coefficients[12];
+			for (GRuint k(0); k < 12; k++) {
+				coefficients[k] = coefficient_values.data() + k * (size_t)segment_count;
+			}
+			for (GRuint s(0); s < segment_count; s++) {
+				HermiteSegment hermite = segment(s);
+				const Vector3f* terms[4] = { &hermite.a, &hermite.b, &hermite.c, &hermite.d };
+				for (GRuint k(0); k < 4; k++) {
+					coefficient_values[k * (size_t)segment_count + s] = terms[k]->X();
+					coefficient_values[(4 + k) * (size_t)segment_count + s] = terms[k]->Y();
+					coefficient_values[(8 + k) * (size_t)segment_count + s] = terms[k]->Z();
+				}
+			}
+
+			std::vector<GRfloat> values((tangents ? 6 : 3) * (size_t)sample_count);
+			GRfloat* x = values.data();
+			GRfloat* y = x + sample_count;
+			GRfloat* z = y + sample_count;
+			GRfloat* tx = tangents ? z + sample_count : nullptr;
+			curve_kernels::cubic_evaluate(coefficients, segment_indices.data(), u.data(), sample_count,
+				x, y, z, tx, tangents ? tx + sample_count : nullptr, tangents ? tx + 2 * sample_count : nullptr);
+
+			points.resize(sample_count);
+			vector_batch::interleave(x, y, z, sample_count, points.data());
+			if (tangents) {
+				tangents->resize(sample_count);
+				vector_batch::interleave(tx, tx + sample_count, tx + 2 * sample_count, sample_count, tangents->data());
+				for (auto& tangent : *tangents) {
+					tangent.normalize();
+				}
+			}
+		}
+
+		/** Samples the curve with count points evenly spaced in parameter (count >= 2)*/
+		void sample(GRuint count, std::vector<Vector3f>& points, std::vector<Vector3f>* tangents = nullptr) const {
+			std::vector<GRfloat> parameters(MAX(count, 2));
+			for (GRuint i(0); i < parameters.size(); i++) {
+				parameters[i] = (GRfloat)i / (GRfloat)(parameters.size() - 1);
+			}
+			sample(parameters, points, tangents);
+		}
+
+		/** Resamples the curve so that the polyline between consecutive samples is never further than about
+		max_error from the curve : each segment is halved until the middle of every piece is within max_error
+		of the middle of its chord, so the samples get denser where the curve bends.
+		The curve's points are kept and the tangents of the result are the normalized derivatives*/
+		SplineCurve resample(GRfloat max_error) const {
+			if (size() < 2) {
+				throw std::invalid_argument("Cannot resample a SplineCurve with less than two points");
+			}
+			max_error = MAX(max_error, FLT_EPSILON);
+
+			struct Piece {
+				GRfloat start;
+				GRfloat end;
+				GRuint depth;
+			};
+
+			std::vector<PointTangent> result;
+			std::vector<Piece> pieces;
+			for (GRuint i(0); i < size() - 1; i++) {
+				HermiteSegment hermite = segment(i);
+				result.push_back(PointTangent(hermite.a, hermite.b.normalized()));
+
+				pieces.push_back({ 0.f, 1.f, 0 });
+				while (pieces.size()) {
+					Piece piece = pieces.back();
+					pieces.pop_back();
+
+					GRfloat middle = 0.5f * (piece.start + piece.end);
+					Vector3f chord_middle = (hermite.position(piece.start) + hermite.position(piece.end)) * 0.5f;
+					Vector3f curve_middle = hermite.position(middle);
+					if (piece.depth < SPLINE_RESAMPLING_MAX_DEPTH && (curve_middle - chord_middle).norm() > max_error) {
+						pieces.push_back({ middle, piece.end, piece.depth + 1 });
+						pieces.push_back({ piece.start, middle, piece.depth + 1 });
+					}
+					else if (piece.end < 1.f) {
+						result.push_back(PointTangent(hermite.position(piece.end), hermite.derivative(piece.end).normalized()));
+					}
+				}
+			}
+			result.push_back(PointTangent(back().first, segment((GRuint)size() - 2).derivative(1.f).normalized()));
+			return SplineCurve(result);
+		}
+
+
 		void add_middle_point(PointTangent middle_point) {
 			PointTangent end = back();
 
@@ -209,6 +388,86 @@ namespace grapholon {
 	};
 
 
+
+	/** Arc length parameterization of a SplineCurve : the curve's length is tabulated at samples_per_segment
+	points per segment so that converting between arc length and parameter is a binary search.
+	Build it once per curve and keep it with the curve, it must be rebuilt when the curve changes*/
+	class SplineArcLength {
+	private:
+		std::vector<GRfloat> parameters_;
+		std::vector<GRfloat> lengths_;
+
+	public:
+		SplineArcLength() {}
+
+		explicit SplineArcLength(const SplineCurve& curve, GRuint samples_per_segment = SPLINE_ARC_LENGTH_SAMPLES) {
+			assign(curve, samples_per_segment);
+		}
+
+		/** Throws a std::invalid_argument if the curve has less than two points*/
+		void assign(const SplineCurve& curve, GRuint samples_per_segment = SPLINE_ARC_LENGTH_SAMPLES) {
+			if (curve.size() < 2) {
+				throw std::invalid_argument("Cannot parameterize a SplineCurve with less than two points by arc length");
+			}
+			samples_per_segment = MAX(samples_per_segment, 1);
+			GRuint segment_count = (GRuint)curve.size() - 1;
+			parameters_.assign(1, 0.f);
+			lengths_.assign(1, 0.f);
+			for (GRuint i(0); i < segment_count; i++) {
+				HermiteSegment hermite = curve.segment(i);
+				Vector3f previous = hermite.a;
+				for (GRuint k(1); k <= samples_per_segment; k++) {
+					GRfloat u = (GRfloat)k / (GRfloat)samples_per_segment;
+					Vector3f current = hermite.position(u);
+					parameters_.push_back(((GRfloat)i + u) / (GRfloat)segment_count);
+					lengths_.push_back(lengths_.back() + (current - previous).norm());
+					previous = current;
+				}
+			}
+		}
+
+		GRfloat length() const {
+			return lengths_.back();
+		}
+
+		/** Curve parameter (see SplineCurve::evaluate()) at the given arc length from the start of the curve*/
+		GRfloat parameter(GRfloat arc_length) const {
+			if (arc_length <= 0.f) {
+				return 0.f;
+			}
+			if (arc_length >= length()) {
+				return 1.f;
+			}
+			size_t next = std::upper_bound(lengths_.begin(), lengths_.end(), arc_length) - lengths_.begin();
+			GRfloat span = lengths_[next] - lengths_[next - 1];
+			GRfloat ratio = span > FLT_EPSILON ? (arc_length - lengths_[next - 1]) / span : 0.f;
+			return parameters_[next - 1] + ratio * (parameters_[next] - parameters_[next - 1]);
+		}
+
+		/** Arc length from the start of the curve at the given curve parameter*/
+		GRfloat arc_length(GRfloat parameter) const {
+			if (parameter <= 0.f) {
+				return 0.f;
+			}
+			if (parameter >= 1.f) {
+				return length();
+			}
+			size_t next = std::upper_bound(parameters_.begin(), parameters_.end(), parameter) - parameters_.begin();
+			GRfloat ratio = (parameter - parameters_[next - 1]) / (parameters_[next] - parameters_[next - 1]);
+			return lengths_[next - 1] + ratio * (lengths_[next] - lengths_[next - 1]);
+		}
+
+		/** Samples the curve with count points evenly spaced along its length (count >= 2)*/
+		void sample(const SplineCurve& curve, GRuint count, std::vector<Vector3f>& points, std::vector<Vector3f>* tangents = nullptr) const {
+			std::vector<GRfloat> parameters(MAX(count, 2));
+			for (GRuint i(0); i < parameters.size(); i++) {
+				parameters[i] = parameter(length() * (GRfloat)i / (GRfloat)(parameters.size() - 1));
+			}
+			curve.sample(parameters, points, tangents);
+		}
+	};
+
+
 	/** Inherits from std::vector so we can use the same interface on it*/
 	class DiscreteCurve : public std::vector<Vector3f> {
 	private:
@@ -217,6 +476,8 @@ namespace grapholon {
 
 		typedef enum { START_AND_END, CURVE_FITTING, FULL_CURVE, MIDDLE_POINT } CONVERSION_METHOD;
 
+		typedef enum { MOVING_AVERAGE, GAUSSIAN, SAVITZKY_GOLAY } SMOOTHING_KERNEL;
+
 #define MAX_CURVE_FITTING_ITERATIONS 10
 #define DEFAULT_MAX_ERROR 0.1f
 
@@ -268,147 +529,230 @@ namespace grapholon {
 
 
 
-		void fit_curve_rec(GRuint start,
-			GRuint end,
-			GRuint current_iteration,
-			GRfloat max_error,
-			std::vector<Vector3f>& result,
-			std::vector<bool>& is_set) {
-			if (start <= end
-				&& start < size()
-				&& end < size()
-				&& current_iteration <= MAX_CURVE_FITTING_ITERATIONS) {
-				//std::cout << "current iteration : " << current_iteration << std::endl;
-				//std::cout << " from " << start << " to " << end << std::endl;
-
-				GRfloat error;
-
-				GRuint furthest_point_index(furthest_point_to_line_index(start, end, (*this)[start], (*this)[end], error));
-
-				//std::cout<< "furthest_point_index : " << furthest_point_index << std::endl;
-				//std::cout << "error : " << error << std::endl;
-				if (!is_set[furthest_point_index]) {
-					is_set[furthest_point_index] = true;
-
-					Vector3f point = (*this)[furthest_point_index];
-					//std::cout << "point : " << point.to_string() << std::endl;
-
-					/*Vector3f local_tangent;
-					if (furthest_point_index > 0 && furthest_point_index < size() - 1) {
-						local_tangent = (*this)[furthest_point_index + 1] - (*this)[furthest_point_index - 1];
-					}*/
-					//std::cout << "tangent : " << local_tangent.to_string() << std::endl;
-
-					result[furthest_point_index] = point;
-
-					if (error > max_error) {
-						fit_curve_rec(start, furthest_point_index, current_iteration + 1, max_error, result, is_set);
-						fit_curve_rec(furthest_point_index, end, current_iteration + 1, max_error, result, is_set);
-					}
-				}
-			}
-		}
-
-		void fit_curve(std::vector<Vector3f>& result, GRfloat max_error = DEFAULT_MAX_ERROR) {
+		/** Ramer-Douglas-Peucker simplification of the curve : appends to 'result', in order, the points that keep the
+		curve within max_error of the polyline they form. The ends of the curve are not part of the result.
+		The spans to split are kept on an explicit stack (depth-first, first half first) and limited to
+		MAX_CURVE_FITTING_ITERATIONS successive splits. The furthest point of each span is found by a vectorized scan
+		of a structure-of-arrays copy of the points (see curve_kernels::furthest_point_to_line_index) : a span whose
+		ends are at the same place (e.g. a loop) uses the distance to that place*/
+		void fit_curve(std::vector<Vector3f>& result, GRfloat max_error = DEFAULT_MAX_ERROR) const {
 
 			//to avoid 0.f max error
 			if (max_error < FLT_EPSILON) {
 				max_error = FLT_EPSILON;
 			}
 
-			std::vector<Vector3f> result_rec(size());
-			std::vector<bool> is_set(size());
+			GRuint point_count = (GRuint)size();
+			if (point_count < 2) {
+				return;
+			}
 
+			std::vector<GRfloat> coordinates(3 * (size_t)point_count);
+			GRfloat* x = coordinates.data();
+			GRfloat* y = x + point_count;
+			GRfloat* z = y + point_count;
+			vector_batch::deinterleave(data(), point_count, x, y, z);
+
+			/** Only the ends of a span can already be part of the result*/
+			struct Span {
+				GRuint start;
+				GRuint end;
+				GRuint iteration;
+				bool start_is_set;
+				bool end_is_set;
+			};
+
+			std::vector<GRuint> selected;
+			std::vector<Span> spans;
+			spans.push_back({ 1, point_count - 1, 0, false, false });
+			while (spans.size()) {
+				Span span = spans.back();
+				spans.pop_back();
+
+				if (span.start > span.end || span.iteration > MAX_CURVE_FITTING_ITERATIONS) {
+					continue;
+				}
 
-			fit_curve_rec(1, (GRuint)size() - 1, 0, max_error, result_rec, is_set);
+				GRfloat error;
+				GRuint furthest_point_index = curve_kernels::furthest_point_to_line_index(x, y, z,
+					span.start, span.end, (*this)[span.start], (*this)[span.end], error);
 
+				if ((furthest_point_index == span.start && span.start_is_set)
+					|| (furthest_point_index == span.end && span.end_is_set)) {
+					continue;
+				}
+				selected.push_back(furthest_point_index);
 
-			for (GRuint i(0); i < size(); i++) {
-				if (is_set[i]) {
-					result.push_back(result_rec[i]);
+				if (error > max_error) {
+					spans.push_back({ furthest_point_index, span.end, span.iteration + 1, true, span.end_is_set });
+					spans.push_back({ span.start, furthest_point_index, span.iteration + 1, span.start_is_set, true });
 				}
 			}
-		}
-
-
 
+			std::sort(selected.begin(), selected.end());
+			for (auto index : selected) {
+				result.push_back((*this)[index]);
+			}
+		}
 
-		/** NOTE : allocates a new SplineCurve -> call 'delete' on the return value*/
-		SplineCurve* to_spline_curve(CONVERSION_METHOD method, void* extra_parameter = nullptr) {
+		/** Builds the SplineCurve corresponding to this curve with the given method (see to_spline_curve())*/
+		SplineCurve make_spline_curve(CONVERSION_METHOD method, GRfloat max_error = DEFAULT_MAX_ERROR) const {
 			if (size() < 2) {
-				throw std::invalid_argument("Cannot convert DiscreteCurve with less than two points to SplineCurve. Returning nullptr");
+				throw std::invalid_argument("Cannot convert DiscreteCurve with less than two points to SplineCurve");
 			}
-			else if (size() == 2 || size() == 3) {
-				return new SplineCurve(*this);
+			if (size() == 2 || size() == 3) {
+				return SplineCurve(*this);
 			}
-			else {
-				switch (method) {
-				case START_AND_END: {
-
-					return new SplineCurve(front(), back());
-
-					break;
-				}
-				case MIDDLE_POINT: {
-
-					GRuint middle_point_index = (GRuint)size() / 2;
 
-					std::vector<Vector3f> points;
-					points.push_back(front());
-					points.push_back((front() + back())*0.5f);
-					points.push_back(back());
+			switch (method) {
+			case MIDDLE_POINT: {
+				std::vector<Vector3f> points;
+				points.push_back(front());
+				points.push_back((front() + back())*0.5f);
+				points.push_back(back());
 
-					return new SplineCurve(points);
+				return SplineCurve(points);
+			}
+			case CURVE_FITTING: {
+				std::vector<Vector3f> points;
+				points.push_back(front());
+				fit_curve(points, max_error);
+				points.push_back(back());
 
-					break;
-				}
-				case CURVE_FITTING: {
+				return SplineCurve(points);
+			}
+			case FULL_CURVE: {
+				return SplineCurve(*this);
+			}
+			case START_AND_END:
+			default: {
+				return SplineCurve(front(), back());
+			}
+			}
+		}
 
-					std::vector<Vector3f> points;
-					points.push_back(front());
+		/** NOTE : allocates a new SplineCurve -> call 'delete' on the return value.
+		extra_parameter points to the max error (a GRfloat) of the CURVE_FITTING method, DEFAULT_MAX_ERROR is used if it is null*/
+		SplineCurve* to_spline_curve(CONVERSION_METHOD method, void* extra_parameter = nullptr) const {
+			GRfloat max_error = extra_parameter == nullptr ? DEFAULT_MAX_ERROR : *((GRfloat*)extra_parameter);
+			return new SplineCurve(make_spline_curve(method, max_error));
+		}
 
-					GRfloat default_error;
-					if (extra_parameter == nullptr) {
-						extra_parameter = &default_error;
-					}
+		/** Converts many curves at once (e.g. the branches of a skeleton), on thread_count threads (0 uses all the hardware threads).
+		Throws a std::invalid_argument if one of them has less than two points*/
+		static std::vector<SplineCurve> to_spline_curves(const std::vector<DiscreteCurve>& curves, CONVERSION_METHOD method,
+			GRfloat max_error = DEFAULT_MAX_ERROR, GRuint thread_count = 0) {
+			std::vector<SplineCurve> splines(curves.size());
+			parallel_for(0, (GRuint)curves.size(), [&](GRuint i) {
+				splines[i] = curves[i].make_spline_curve(method, max_error);
+			}, thread_count);
+			return splines;
+		}
 
-					fit_curve(points, *((GRfloat*)extra_parameter));
-					points.push_back(back());
+		/** Moving average over window_width points (window_width / 2 on each side, less near the ends of the curve).
+		The ends of the curve do not move. The curve is smoothed in place, in O(n) whatever the window : a running sum
+		(in double precision) slides along the curve and the original positions of the points already smoothed that are
+		still in the window are kept in a ring buffer*/
+		void smooth_moving_average(GRuint window_width) {
+			if (window_width <= 2 || window_width >= size()) {
+				return;
+			}
+			GRuint point_count = (GRuint)size();
+			GRuint radius = window_width / 2;
+			std::vector<Vector3f> ring(radius + 1);
+
+			auto original = [&](GRuint index, GRuint current) -> const Vector3f& {
+				return index < current && index > 0 ? ring[index % (radius + 1)] : (*this)[index];
+			};
+
+			GRdouble sum[3] = { 0., 0., 0. };
+			auto add = [&](const Vector3f& point, GRdouble sign) {
+				sum[0] += sign * point.X();
+				sum[1] += sign * point.Y();
+				sum[2] += sign * point.Z();
+			};
+
+			GRuint start(0), end(MIN(point_count - 1, 1 + radius));
+			for (GRuint j(start); j <= end; j++) {
+				add((*this)[j], 1.);
+			}
 
-					return new SplineCurve(points);
+			for (GRuint i(1); i < point_count - 1; i++) {
+				GRuint new_start = i < radius ? 0 : i - radius;
+				GRuint new_end = MIN(point_count - 1, i + radius);
+				while (end < new_end) {
+					add(original(++end, i), 1.);
+				}
+				while (start < new_start) {
+					add(original(start++, i), -1.);
 				}
-				case FULL_CURVE: {
 
-					return new SplineCurve(*this);
+				ring[i % (radius + 1)] = (*this)[i];
+				GRdouble count = (GRdouble)(end - start + 1);
+				(*this)[i] = Vector3f((GRfloat)(sum[0] / count), (GRfloat)(sum[1] / count), (GRfloat)(sum[2] / count));
+			}
+		}
 
-					break;
-				}
-				default: {
-					return to_spline_curve(START_AND_END);
+		/** Smooths the curve in place with the given kernel over window_width points (window_width / 2 on each side).
+		The ends of the curve do not move and nothing is done if window_width <= 2 or >= the number of points.
+		 - MOVING_AVERAGE : see smooth_moving_average()
+		 - GAUSSIAN : weights exp(-d^2 / (2 sigma^2)) with sigma = window_width / 4, i.e. the window spans +/- 2 sigma.
+		   Near the ends the window is cut and the remaining weights normalized
+		 - SAVITZKY_GOLAY : least-squares fit of a quadratic over the window (keeps the peaks better than an average).
+		   Near the ends the window shrinks to stay centered
+		Each point is computed in one pass over its window, from the original positions kept in a ring buffer*/
+		void smooth(SMOOTHING_KERNEL kernel, GRuint window_width) {
+			if (kernel == MOVING_AVERAGE) {
+				smooth_moving_average(window_width);
+				return;
+			}
+			if (window_width <= 2 || window_width >= size()) {
+				return;
+			}
+			GRuint point_count = (GRuint)size();
+			GRuint radius = window_width / 2;
+
+			//weights[r][|d|] : the weight of the point at distance d in a window of radius r (only r = radius for GAUSSIAN)
+			std::vector<std::vector<GRdouble>> weights(radius + 1);
+			if (kernel == GAUSSIAN) {
+				GRdouble sigma = (GRdouble)window_width / 4.;
+				for (GRuint d(0); d <= radius; d++) {
+					weights[radius].push_back(exp(-(GRdouble)(d * d) / (2. * sigma * sigma)));
 				}
+			}
+			else {
+				for (GRuint r(1); r <= radius; r++) {
+					GRdouble m = (GRdouble)r;
+					GRdouble normalization = (2. * m - 1.) * (2. * m + 1.) * (2. * m + 3.);
+					for (GRuint d(0); d <= r; d++) {
+						weights[r].push_back((3. * (3. * m * m + 3. * m - 1.) - 15. * (GRdouble)(d * d)) / normalization);
+					}
 				}
 			}
-		}
 
-		void smooth_moving_average(GRuint window_width) {
-			if (window_width > 2 && window_width < size()) {
-				DiscreteCurve smoothed;
-				smoothed.push_back(front());
-
-				for (GRuint i(1); i < size() - 1; i++) {
-					//std::cout << "smoothing element " << i << std::endl;
-					GRuint start((GRuint)(i < window_width / 2 ? 0 : i - window_width / 2));
-					GRuint end((GRuint)((i + window_width / 2) >= size() ? size() - 1 : i + window_width / 2));
-
-					//std::cout << "from " << start << " to " << end << std::endl;
-					Vector3f local_average(0.f);
-					for (GRuint j(start); j <= end; j++) {
-						local_average += (*this)[j];
-					}
-					smoothed.push_back(local_average / (GRfloat)(end - start + 1));
+			std::vector<Vector3f> ring(radius + 1);
+			for (GRuint i(1); i < point_count - 1; i++) {
+				GRuint window_radius = radius;
+				if (kernel == SAVITZKY_GOLAY) {
+					window_radius = MIN(radius, MIN(i, point_count - 1 - i));
+				}
+				GRuint start = i < window_radius ? 0 : i - window_radius;
+				GRuint end = MIN(point_count - 1, i + window_radius);
+				const std::vector<GRdouble>& window_weights = weights[kernel == GAUSSIAN ? radius : window_radius];
+
+				GRdouble sum[3] = { 0., 0., 0. };
+				GRdouble weight_sum(0.);
+				for (GRuint j(start); j <= end; j++) {
+					const Vector3f& point = j < i && j > 0 ? ring[j % (radius + 1)] : (*this)[j];
+					GRdouble weight = window_weights[j < i ? i - j : j - i];
+					sum[0] += weight * point.X();
+					sum[1] += weight * point.Y();
+					sum[2] += weight * point.Z();
+					weight_sum += weight;
 				}
-				smoothed.push_back(back());
-				(*this) = smoothed;
+
+				ring[i % (radius + 1)] = (*this)[i];
+				(*this)[i] = Vector3f((GRfloat)(sum[0] / weight_sum), (GRfloat)(sum[1] / weight_sum), (GRfloat)(sum[2] / weight_sum));
 			}
 		}
 
@@ -449,13 +793,46 @@ namespace grapholon {
 	};
 
 
-	/** Extension of SplineCurve that can be deformed with various methods*/
+	/** Settings of DeformableSplineCurve::pseudo_elastic_deform's relaxation. The defaults give its original behavior*/
+	struct ElasticDeformParameters {
+		typedef enum {
+			GAUSS_SEIDEL,///< points are updated one after the other, each one seeing its neighbours' new positions
+			JACOBI,///< all the points are updated from the previous iteration's positions
+			CHEBYSHEV///< Jacobi iterations with Chebyshev acceleration (see chebyshev_spectral_radius)
+		} Method;
+
+		Method method = GAUSS_SEIDEL;
+		GRuint max_iterations = 10;
+		GRfloat tolerance = 0.1f;///< the relaxation stops once no point moves by more than this during an iteration
+		GRfloat elastic_constant = 0.5f;
+		GRfloat mass = 1.f;
+		GRfloat shape_weight = 0.05f;///< to what extent the original positions are important
+		GRfloat jacobi_damping = 0.5f;///< JACOBI and CHEBYSHEV scale their steps by this : all the points moving at once overshoot otherwise
+		GRfloat chebyshev_spectral_radius = 0.8f;///< estimate of the (damped) Jacobi iteration's spectral radius, in [0, 1)
+		bool warm_start = true;///< start from the current positions (the previous deformation) instead of the original shape
+	};
+
+
+	/** Extension of SplineCurve that can be deformed with various methods.
+	The shape the deformations start from (the original shape) is only allocated when a deformation needs it :
+	most curves are never deformed. It is released when the curve's shape is committed (see release_original_shape())*/
 	class DeformableSplineCurve : public SplineCurve {
-	public:
+	private:
+		struct OriginalShape {
+			std::vector<GRfloat> lengths;
+			std::vector<Vector3f> points;
+			std::vector<GRfloat> angles;
+		};
 
-		std::vector<GRfloat> original_lengths_ = std::vector<GRfloat>();
-		std::vector<Vector3f> original_points_ = std::vector<Vector3f>();
-		std::vector<GRfloat> original_angles_ = std::vector<GRfloat>();
+		std::unique_ptr<OriginalShape> original_shape_;
+
+		/** Sets the original shape if it is missing or doesn't match the curve anymore*/
+		OriginalShape& original_shape() {
+			if (!has_original_shape()) {
+				set_original_shape();
+			}
+			return *original_shape_;
+		}
 
 	public:
 		DeformableSplineCurve() : SplineCurve() {
@@ -464,9 +841,7 @@ namespace grapholon {
 		DeformableSplineCurve(PointTangent start, PointTangent end) : SplineCurve(start, end) {}
 
 		
-		DeformableSplineCurve(std::vector<Vector3f> points) : SplineCurve(points) {
-			set_original_shape();
-		}
+		DeformableSplineCurve(std::vector<Vector3f> points) : SplineCurve(points) {}
 		
 
 		DeformableSplineCurve(std::vector<PointTangent> points_and_tangents)
@@ -478,9 +853,6 @@ namespace grapholon {
 			//todo : clear instead of replace
 			this->clear();
 			if (! other.size()) {
-				original_lengths_ = std::vector<GRfloat>();
-				original_points_ = std::vector<Vector3f>();
-				original_angles_ = std::vector<GRfloat>();
 				return;
 			}
 			size_t pts_size = other.size();
@@ -490,11 +862,20 @@ namespace grapholon {
 				push_back(other[idx]);
 				this->back().second *= reverse_factor;
 			}
+		}
 
-			original_lengths_ = std::vector<GRfloat>();
-			original_points_ = std::vector<Vector3f>();
-			original_angles_ = std::vector<GRfloat>();
+		/** Moving a curve steals its buffers (original shape included) instead of copying them*/
+		DeformableSplineCurve(DeformableSplineCurve&& other) = default;
+
+		/** Unlike the copy constructor, assigning a curve copies its original shape too*/
+		DeformableSplineCurve& operator=(const DeformableSplineCurve& other) {
+			if (this != &other) {
+				SplineCurve::operator=(other);
+				original_shape_.reset(other.original_shape_ ? new OriginalShape(*other.original_shape_) : nullptr);
+			}
+			return *this;
 		}
+		DeformableSplineCurve& operator=(DeformableSplineCurve&& other) = default;
 
 		/*DeformableSplineCurve(const DiscreteCurve& curve) {
 			for (auto point : curve) {
@@ -513,28 +894,42 @@ namespace grapholon {
 			return discrete_curve;
 		}
 
-		/** Used as reference when deforming*/
+		/** Used as reference when deforming. The deformations set it themselves when it is missing*/
 		void set_original_shape() {
-			original_lengths_.clear();
-			original_points_.clear();
-			original_angles_.clear();
+			if (!original_shape_) {
+				original_shape_.reset(new OriginalShape());
+			}
+			OriginalShape& shape = *original_shape_;
+			shape.lengths.clear();
+			shape.points.clear();
+			shape.angles.clear();
 			
 			for (GRuint i(0); i < size() - 1; i++) {
-				original_lengths_.push_back(((*this)[i + 1].first - (*this)[i].first).norm());
-
-				original_points_.push_back((*this)[i].first);
+				shape.lengths.push_back(((*this)[i + 1].first - (*this)[i].first).norm());
 
-				/*std::cout << " next : " << (*this)[i + 1].first.to_string() << std::endl;
-				std::cout << " this : " << (*this)[i].first.to_string() << std::endl;
-				std::cout << " tan : " << (*this)[i].second.to_string() << std::endl;*/
+				shape.points.push_back((*this)[i].first);
 
-				original_angles_.push_back((*this)[i].second.angular_distance((*this)[i + 1].first - (*this)[i].first));
-				//std::cout << "angle " << i << " : " << original_angles_[i] << std::endl;
+				shape.angles.push_back((*this)[i].second.angular_distance((*this)[i + 1].first - (*this)[i].first));
 			}
 
-			original_points_.push_back(back().first);
+			shape.points.push_back(back().first);
+		}
+
+		/** Frees the original shape : the next deformation starts from the curve's shape at that time.
+		Call it when the curve's shape is committed or when the curve changed so much that its original shape is meaningless*/
+		void release_original_shape() {
+			original_shape_.reset();
+		}
 
-			//std::cout << "original shape is now : " << original_points_.size() << std::endl;
+		/** True if the original shape is set and has as many points as the curve*/
+		bool has_original_shape() const {
+			return original_shape_ && original_shape_->points.size() == size();
+		}
+
+		/** The original shape's points, empty if it is not set*/
+		const std::vector<Vector3f>& original_points() const {
+			static const std::vector<Vector3f> no_points;
+			return original_shape_ ? original_shape_->points : no_points;
 		}
 
 
@@ -569,6 +964,161 @@ namespace grapholon {
 		}
 
 
+		/** Relaxation sweeps updating the points in place*/
+		GRuint relax_gauss_seidel(const ElasticDeformParameters& parameters) {
+			const OriginalShape& shape = original_shape();
+			GRfloat mu(parameters.shape_weight);
+			GRfloat step(parameters.elastic_constant / parameters.mass);
+			GRfloat squared_tolerance(parameters.tolerance * parameters.tolerance);
+
+			GRuint iteration_count(0);
+			GRfloat max_displacement;
+			do {
+				max_displacement = 0.f;
+
+				for (GRuint i(1); i < size() - 1; i++) {
+					Vector3f x_prev = (*this)[i - 1].first;
+					Vector3f x_i = (*this)[i].first;
+					Vector3f x_next = (*this)[i + 1].first;
+
+					Vector3f left_direction = x_prev - x_i;
+					GRfloat left_direction_norm = left_direction.norm();
+					Vector3f left_force = left_direction_norm < FLT_EPSILON
+						? Vector3f(0.f) : left_direction * (1.f - shape.lengths[i - 1] / left_direction_norm);
+
+					Vector3f right_direction = x_next - x_i;
+					GRfloat right_direction_norm = right_direction.norm();
+					Vector3f right_force = right_direction_norm < FLT_EPSILON
+						? Vector3f(0.f) : right_direction * (1.f - shape.lengths[i] / right_direction_norm);
+
+					Vector3f original_force = (shape.points[i] - x_i).normalized();
+
+					Vector3f displacement = ((left_force + right_force) * (1.f - mu) + original_force * mu)*step;
+
+					(*this)[i].first = x_i + displacement;
+
+					max_displacement = MAX(max_displacement, displacement.dot(displacement));
+				}
+
+				iteration_count++;
+			} while (max_displacement > squared_tolerance && iteration_count < parameters.max_iterations);
+
+			return iteration_count;
+		}
+
+		/** Relaxation iterations computing all the new positions from the previous ones (with Chebyshev acceleration if asked).
+		The points are copied in separate x, y and z arrays so that the loops can be vectorized*/
+		GRuint relax_jacobi(const ElasticDeformParameters& parameters) {
+			GRuint point_count = (GRuint)size();
+			if (point_count < 3) {
+				return 0;
+			}
+			const OriginalShape& shape = original_shape();
+			GRuint segment_count = point_count - 1;
+
+			GRfloat mu(parameters.shape_weight);
+			GRfloat step(parameters.jacobi_damping * parameters.elastic_constant / parameters.mass);
+			GRfloat squared_tolerance(parameters.tolerance * parameters.tolerance);
+			bool chebyshev = parameters.method == ElasticDeformParameters::CHEBYSHEV;
+			GRfloat squared_radius = parameters.chebyshev_spectral_radius * parameters.chebyshev_spectral_radius;
+
+			//current, previous and next positions, and the spring force of each segment
+			std::vector<GRfloat> current(3 * point_count), previous, next(3 * point_count), force(3 * segment_count);
+			GRfloat* x = current.data();
+			GRfloat* y = x + point_count;
+			GRfloat* z = y + point_count;
+			for (GRuint i(0); i < point_count; i++) {
+				x[i] = (*this)[i].first.X();
+				y[i] = (*this)[i].first.Y();
+				z[i] = (*this)[i].first.Z();
+			}
+			next = current;
+			if (chebyshev) {
+				previous = current;
+			}
+			std::vector<GRfloat> original(3 * point_count);
+			vector_batch::deinterleave(shape.points.data(), point_count, original.data(), original.data() + point_count, original.data() + 2 * point_count);
+
+			GRfloat omega(1.f);
+			GRuint iteration_count(0);
+			GRfloat max_displacement;
+			do {
+				x = current.data();
+				y = x + point_count;
+				z = y + point_count;
+				GRfloat* fx = force.data();
+				GRfloat* fy = fx + segment_count;
+				GRfloat* fz = fy + segment_count;
+
+				for (GRuint k(0); k < segment_count; k++) {
+					GRfloat dx = x[k + 1] - x[k];
+					GRfloat dy = y[k + 1] - y[k];
+					GRfloat dz = z[k + 1] - z[k];
+					GRfloat length = sqrtf(dx * dx + dy * dy + dz * dz);
+					GRfloat factor = length < FLT_EPSILON ? 0.f : 1.f - shape.lengths[k] / length;
+					fx[k] = dx * factor;
+					fy[k] = dy * factor;
+					fz[k] = dz * factor;
+				}
+
+				if (chebyshev) {
+					omega = iteration_count == 0 ? 1.f
+						: iteration_count == 1 ? 2.f / (2.f - squared_radius)
+						: 4.f / (4.f - squared_radius * omega);
+				}
+
+				max_displacement = 0.f;
+				for (GRuint c(0); c < 3; c++) {
+					const GRfloat* position = current.data() + c * point_count;
+					const GRfloat* segment_force = force.data() + c * segment_count;
+					GRfloat* new_position = next.data() + c * point_count;
+					for (GRuint i(1); i < segment_count; i++) {
+						new_position[i] = position[i] + (segment_force[i] - segment_force[i - 1]) * (1.f - mu) * step;
+					}
+				}
+
+				//the pull toward the original shape (a unit vector) and the acceleration
+				for (GRuint i(1); i < segment_count; i++) {
+					GRfloat ox = original[i] - x[i];
+					GRfloat oy = original[point_count + i] - y[i];
+					GRfloat oz = original[2 * point_count + i] - z[i];
+					GRfloat original_norm = sqrtf(ox * ox + oy * oy + oz * oz);
+					GRfloat pull = (original_norm > FLT_EPSILON ? 1.f / original_norm : 1.f) * mu * step;
+
+					GRfloat nx = next[i] + ox * pull;
+					GRfloat ny = next[point_count + i] + oy * pull;
+					GRfloat nz = next[2 * point_count + i] + oz * pull;
+					if (chebyshev) {
+						nx = previous[i] + omega * (nx - previous[i]);
+						ny = previous[point_count + i] + omega * (ny - previous[point_count + i]);
+						nz = previous[2 * point_count + i] + omega * (nz - previous[2 * point_count + i]);
+					}
+					next[i] = nx;
+					next[point_count + i] = ny;
+					next[2 * point_count + i] = nz;
+
+					GRfloat mx = nx - x[i], my = ny - y[i], mz = nz - z[i];
+					max_displacement = MAX(max_displacement, mx * mx + my * my + mz * mz);
+				}
+
+				//the ends never move so every buffer keeps them
+				if (chebyshev) {
+					previous.swap(current);
+				}
+				current.swap(next);
+
+				iteration_count++;
+			} while (max_displacement > squared_tolerance && iteration_count < parameters.max_iterations);
+
+			x = current.data();
+			y = x + point_count;
+			z = y + point_count;
+			for (GRuint i(1); i < segment_count; i++) {
+				(*this)[i].first = Vector3f(x[i], y[i], z[i]);
+			}
+			return iteration_count;
+		}
+
 		//x should be in [0, 1]
 		GRfloat smoothing_function(GRfloat x) {
 			return sqrtf(x);
@@ -609,91 +1159,45 @@ namespace grapholon {
 				(*this)[second_junction_index + 1].second = ((*this)[second_junction_index + 2].first - (*this)[second_junction_index].first).normalize();
 			}
 
-			set_original_shape();
+			release_original_shape();
 		}
 
-		bool pseudo_elastic_deform(bool source, Vector3f new_position, bool maintain_shape_around_tip = true) {
+		/** Moves one end of the curve and lets the other points relax like springs around their original lengths.
+		Returns the number of relaxation iterations done through 'iteration_count' if it is not null*/
+		bool pseudo_elastic_deform(bool source, Vector3f new_position, bool maintain_shape_around_tip = true,
+			const ElasticDeformParameters& parameters = ElasticDeformParameters(), GRuint* iteration_count = nullptr) {
 
-			GRfloat max_max_displacement(0.1f);
-			GRfloat elastic_constant(0.5f);
-			//GRfloat time_step(0.01f);
-			GRfloat mass(1.f);
+			const OriginalShape& shape = original_shape();
 
-			//TODO : make safer
-			if (!original_lengths_.size()) {
-				set_original_shape();
+			if (!parameters.warm_start) {
+				for (GRuint i(0); i < size(); i++) {
+					(*this)[i].first = shape.points[i];
+				}
 			}
 
 			Vector3f tip_displacement;
 
 			if (source) {
-				tip_displacement = new_position - original_points_.front();
+				tip_displacement = new_position - shape.points.front();
 				front().first = new_position;
 			}
 			else {
-				tip_displacement = new_position - original_points_.back();
+				tip_displacement = new_position - shape.points.back();
 				back().first = new_position;
 			}
-			GRuint iteration_count(0);
-			GRfloat lambda(0.9f);
-
-			//to what extent the original positions are important
-			GRfloat mu(0.05f);
-
-			GRfloat max_displacement(-std::numeric_limits<GRfloat>::max());
-			do {
-				//std::cout << "------------------------" << std::endl;
-				//std::cout << "	iteration : " << iteration_count << std::endl;
-				max_displacement = -std::numeric_limits<GRfloat>::max();
 
-				for (GRuint i(1); i < size() - 1; i++) {
-					//std::cout << " point : " << i << std::endl;
-					Vector3f x_prev = (*this)[i - 1].first;
-					Vector3f x_i = (*this)[i].first;
-					Vector3f x_next = (*this)[i + 1].first;
-
-					Vector3f t_i = (*this)[i].second;
-
-					//std::cout << " t_i : " << t_i.to_string() << std::endl;
-
-					Vector3f left_direction = x_prev - x_i;
-					GRfloat left_direction_norm = left_direction.norm();
-					Vector3f left_force = left_direction * (1.f - original_lengths_[i - 1] / left_direction_norm);
-					if (left_direction_norm < FLT_EPSILON) {
-						left_force = Vector3f(0.f);
-					}
-
-					Vector3f right_direction = x_next - x_i;
-					GRfloat right_direction_norm = right_direction.norm();
-					Vector3f right_force = right_direction * (1.f - original_lengths_[i] / right_direction_norm);
-					if (right_direction_norm < FLT_EPSILON) {
-						right_force = Vector3f(0.f);
-					}
-
-					Vector3f original_force = (original_points_[i] - x_i).normalized();
-					
-
-					Vector3f displacement = ((left_force + right_force) * (1.f - mu) + original_force * mu)*(elastic_constant / mass);
-
-					x_i += displacement;
-
-					GRfloat displacement_norm = ((*this)[i].first - x_i).norm();
-
-					(*this)[i].first = x_i;
-
-					max_displacement = MAX(max_displacement, displacement_norm);
-				}
-				//std::cout << "max displacement : "<< max_displacement << std::endl;
-
-				lambda *= 0.9f;
-				iteration_count++;
-			} while (max_displacement > max_max_displacement && iteration_count < 10);
+			GRuint iterations = parameters.method == ElasticDeformParameters::GAUSS_SEIDEL
+				? relax_gauss_seidel(parameters)
+				: relax_jacobi(parameters);
+			if (iteration_count) {
+				*iteration_count = iterations;
+			}
 
 			if (maintain_shape_around_tip) {
 				GRfloat alpha = 0.9f;
 
 				for (GRuint i(1); i < size() - 1; i++) {
-					Vector3f relative_direction_displacement = (original_points_[i] + tip_displacement - (*this)[i].first);
+					Vector3f relative_direction_displacement = (shape.points[i] + tip_displacement - (*this)[i].first);
 					GRfloat beta = 0.f;
 					GRfloat beta_prime = smoothing_function(((GRfloat)i / ((GRfloat)size() - 2.f))*alpha);
 
@@ -47,30 +47,14 @@ namespace grapholon {
 			return Vector3f(eigen.x(), eigen.y(), eigen.z());
 		}
 
-		/** Deforms the curve in a As-Rigid-As-Possible manner using the Interactive Geometry Library (IGL)*/
-		static bool deform_curve(DeformableSplineCurve& in_curve, GRuint control_point_index, Vector3f target_position) {
-
-
-			if (in_curve.size() < 4) {
-				return false;
-			}
-
-			if (control_point_index > in_curve.size() - 1) {
-				return false;
-			}
-
-			if (in_curve.original_points_.size() != in_curve.size()) {
-
-				in_curve.set_original_shape();
-			}
-
-
-			std::vector<Vector3f> curve = in_curve.original_points_;
-
-			Eigen::MatrixXd V(curve.size(), 3);
-			Eigen::MatrixXd U(V.cols(), V.rows());
-			Eigen::MatrixXi F((size_t)((GRdouble)curve.size() / 2.0), 3);
+		/** Deforms the curve in a As-Rigid-As-Possible manner using the Interactive Geometry Library (IGL).
+		The precomputation is done from scratch : use a CurveDeformationSession for repeated deformations of the same curve*/
+		static bool deform_curve(DeformableSplineCurve& in_curve, GRuint control_point_index, Vector3f target_position);
 
+		/** Builds the ARAP mesh of the curve's original shape : its points as vertices and triangles made of consecutive points*/
+		static void build_arap_mesh(const std::vector<Vector3f>& curve, Eigen::MatrixXd& V, Eigen::MatrixXi& F) {
+			V = Eigen::MatrixXd(curve.size(), 3);
+			F = Eigen::MatrixXi((size_t)((GRdouble)curve.size() / 2.0), 3);
 
 			for (GRuint i(0); i < curve.size(); i++) {
 				V.row(i) = to_eigen(curve[i]);
@@ -80,14 +64,12 @@ namespace grapholon {
 				F.row(i) = Eigen::Vector3i(i * 2, i * 2 + 1, i * 2 + 2);
 			}
 			F.row(F.rows() - 1) = Eigen::Vector3i(V.rows() - 3, V.rows() - 2, V.rows() - 1);
+		}
 
-			U = V;
-
-
-
-			Eigen::VectorXi S, b;
-
-			if (control_point_index == 0 || control_point_index == curve.size() - 1) {
+		/** The constrained points : both ends and the control point*/
+		static Eigen::VectorXi arap_handles(GRuint point_count, GRuint control_point_index) {
+			Eigen::VectorXi b;
+			if (control_point_index == 0 || control_point_index == point_count - 1) {
 				b = Eigen::VectorXi(2);
 			}
 			else {
@@ -96,9 +78,13 @@ namespace grapholon {
 			}
 
 			b(0) = 0;
-			b(1) = (int)(curve.size() - 1);
+			b(1) = (int)(point_count - 1);
+			return b;
+		}
 
-			Eigen::MatrixXd bc(b.size(), V.cols());
+		/** The handles' positions : the control point goes to target_position and the ends stay where they are*/
+		static Eigen::MatrixXd arap_handle_positions(const DeformableSplineCurve& in_curve, GRuint control_point_index, Vector3f target_position) {
+			Eigen::MatrixXd bc(control_point_index == 0 || control_point_index == in_curve.size() - 1 ? 2 : 3, 3);
 
 			Eigen::VectorXd new_position(to_eigen(target_position));
 
@@ -109,7 +95,7 @@ namespace grapholon {
 				bc.row(0) = to_eigen(in_curve.front().first);
 			}
 
-			if (control_point_index == (V.rows() - 1)) {
+			if (control_point_index == (in_curve.size() - 1)) {
 				bc.row(1) = new_position;
 			}else{
 				bc.row(1) = to_eigen(in_curve.back().first);
@@ -118,32 +104,114 @@ namespace grapholon {
 			if (bc.rows() == 3) {
 				bc.row(2) = new_position;
 			}
+			return bc;
+		}
+	};
 
 
-			/*std::cout << " V : " << V << std::endl;
-			std::cout << "F : " << F << std::endl;
-			std::cout << " b : " << b << std::endl;
-			std::cout << " bc : " << bc << std::endl;*/
+	/** Keeps the ARAP precomputation (i.e. the factorization) of a curve alive between successive deformations
+	with the same handles, e.g. while the user drags a control point : each update then only runs igl::arap_solve.
+	The session stays valid as long as the curve's original shape and the control point don't change (see matches())*/
+	class CurveDeformationSession {
+	private:
+		igl::ARAPData arap_data_;
+		Eigen::MatrixXd V_;
+		Eigen::MatrixXi F_;
+		Eigen::MatrixXd U_;
+		GRuint control_point_index_ = 0;
+		bool active_ = false;
 
+	public:
+		CurveDeformationSession() {}
 
-			igl::ARAPData arap_data;
-			arap_data.energy = igl::ARAP_ENERGY_TYPE_SPOKES;
-			arap_data.max_iter = 100;
-			arap_data.with_dynamics = true;
+		/** Precomputes the deformation of the curve around this control point. Returns false if the curve can't be deformed*/
+		bool begin(DeformableSplineCurve& in_curve, GRuint control_point_index) {
+			active_ = false;
 
-			igl::arap_precomputation(V, F, V.cols(), b, arap_data);
+			if (in_curve.size() < 4) {
+				return false;
+			}
 
+			if (control_point_index > in_curve.size() - 1) {
+				return false;
+			}
 
-			igl::arap_solve(bc, arap_data, U);
+			if (!in_curve.has_original_shape()) {
 
-			for (GRuint i(0); i < V.rows(); i++) {
-				in_curve[i].first = to_vec3(U.row(i));
+				in_curve.set_original_shape();
 			}
-			in_curve.update_tangents();
 
+			CurveDeformer::build_arap_mesh(in_curve.original_points(), V_, F_);
+
+			arap_data_ = igl::ARAPData();
+			arap_data_.energy = igl::ARAP_ENERGY_TYPE_SPOKES;
+			arap_data_.max_iter = 100;
+			arap_data_.with_dynamics = true;
 
+			igl::arap_precomputation(V_, F_, V_.cols(), CurveDeformer::arap_handles((GRuint)V_.rows(), control_point_index), arap_data_);
+
+			control_point_index_ = control_point_index;
+			active_ = true;
 			return true;
 		}
 
+		/** Returns true if the session was started for this control point of this curve (with the same original shape)*/
+		bool matches(const DeformableSplineCurve& in_curve, GRuint control_point_index) const {
+			if (!active_ || control_point_index != control_point_index_
+				|| in_curve.size() != (size_t)V_.rows() || !in_curve.has_original_shape()) {
+				return false;
+			}
+			const std::vector<Vector3f>& original_points = in_curve.original_points();
+			for (GRuint i(0); i < V_.rows(); i++) {
+				if (CurveDeformer::to_eigen(original_points[i]) != Eigen::Vector3d(V_.row(i))) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/** Moves the control point to target_position (the ends stay in place). Returns false if the session is not active*/
+		bool deform(DeformableSplineCurve& in_curve, Vector3f target_position) {
+			if (!active_ || in_curve.size() != (size_t)V_.rows()) {
+				return false;
+			}
+
+			//each update starts from the original shape at rest, as if the precomputation had just been done
+			U_ = V_;
+			arap_data_.vel.setZero();
+
+			igl::arap_solve(CurveDeformer::arap_handle_positions(in_curve, control_point_index_, target_position), arap_data_, U_);
+
+			for (GRuint i(0); i < V_.rows(); i++) {
+				in_curve[i].first = CurveDeformer::to_vec3(U_.row(i));
+			}
+			in_curve.update_tangents();
+
+			return true;
+		}
+
+		/** Ends the session and frees the precomputation and the meshes*/
+		void reset() {
+			active_ = false;
+			arap_data_ = igl::ARAPData();
+			V_.resize(0, 0);
+			F_.resize(0, 0);
+			U_.resize(0, 0);
+		}
+
+		bool is_active() const {
+			return active_;
+		}
+
+		GRuint control_point_index() const {
+			return control_point_index_;
+		}
 	};
+
+
+	inline bool CurveDeformer::deform_curve(DeformableSplineCurve& in_curve, GRuint control_point_index, Vector3f target_position) {
+		CurveDeformationSession session;
+		return session.begin(in_curve, control_point_index)
+			&& session.deform(in_curve, target_position);
+	}
 };
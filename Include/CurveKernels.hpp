@@ -0,0 +1,298 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "Vector.hpp"
+
+namespace grapholon {
+
+	/** Geometry kernels working on curves stored as separate x, y and z arrays (see SoACurve).
+	They process 8 points at a time with AVX2 when the code is compiled for it (-mavx2 or /arch:AVX2)
+	and fall back to plain loops otherwise*/
+	namespace curve_kernels {
+
+#ifdef __AVX2__
+		inline GRfloat horizontal_sum(__m256 values) {
+			__m128 sum = _mm_add_ps(_mm256_castps256_ps128(values), _mm256_extractf128_ps(values, 1));
+			sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+			sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+			return _mm_cvtss_f32(sum);
+		}
+
+		/** Best lane of an arg-min/arg-max reduction : the best value, the smallest index among equal values*/
+		template<typename Better>
+		void reduce_lanes(__m256 values, __m256i indices, GRfloat& best_value, GRuint& best_index, Better better) {
+			alignas(32) GRfloat lane_values[8];
+			alignas(32) std::int32_t lane_indices[8];
+			_mm256_store_ps(lane_values, values);
+			_mm256_store_si256((__m256i*)lane_indices, indices);
+			for (GRuint lane(0); lane < 8; lane++) {
+				if (lane_indices[lane] < 0) {
+					continue;
+				}
+				if (better(lane_values[lane], best_value)
+					|| (lane_values[lane] == best_value && (GRuint)lane_indices[lane] < best_index)) {
+					best_value = lane_values[lane];
+					best_index = (GRuint)lane_indices[lane];
+				}
+			}
+		}
+#endif
+
+		/** Sum of the lengths of the point_count - 1 segments*/
+		inline GRfloat length(const GRfloat* x, const GRfloat* y, const GRfloat* z, GRuint point_count) {
+			GRuint segment_count = point_count > 1 ? point_count - 1 : 0;
+			GRuint i(0);
+			GRfloat length(0.f);
+#ifdef __AVX2__
+			__m256 sum = _mm256_setzero_ps();
+			for (; i + 8 <= segment_count; i += 8) {
+				__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i + 1), _mm256_loadu_ps(x + i));
+				__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i + 1), _mm256_loadu_ps(y + i));
+				__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i + 1), _mm256_loadu_ps(z + i));
+				__m256 squared_norm = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+				sum = _mm256_add_ps(sum, _mm256_sqrt_ps(squared_norm));
+			}
+			length = horizontal_sum(sum);
+#endif
+			for (; i < segment_count; i++) {
+				GRfloat dx = x[i + 1] - x[i];
+				GRfloat dy = y[i + 1] - y[i];
+				GRfloat dz = z[i + 1] - z[i];
+				length += sqrtf(dx * dx + dy * dy + dz * dz);
+			}
+			return length;
+		}
+
+		/** Tangent i = point 'to' - point 'from', normalized if asked and if it is not too small (like Vector3f::normalize())*/
+		inline void set_tangent(const GRfloat* x, const GRfloat* y, const GRfloat* z,
+			GRfloat* tx, GRfloat* ty, GRfloat* tz, GRuint i, GRuint from, GRuint to, bool normalize) {
+			GRfloat dx = x[to] - x[from];
+			GRfloat dy = y[to] - y[from];
+			GRfloat dz = z[to] - z[from];
+			if (normalize) {
+				GRfloat norm = sqrtf(dx * dx + dy * dy + dz * dz);
+				if (norm > FLT_EPSILON) {
+					dx /= norm;
+					dy /= norm;
+					dz /= norm;
+				}
+			}
+			tx[i] = dx;
+			ty[i] = dy;
+			tz[i] = dz;
+		}
+
+		/** Same tangents as SplineCurve::update_tangents() : central differences inside, one-sided ones at the ends*/
+		inline void tangents(const GRfloat* x, const GRfloat* y, const GRfloat* z,
+			GRfloat* tx, GRfloat* ty, GRfloat* tz, GRuint point_count, bool normalize = true) {
+			if (point_count < 2) {
+				return;
+			}
+
+			set_tangent(x, y, z, tx, ty, tz, 0, 0, 1, normalize);
+			GRuint i(1);
+#ifdef __AVX2__
+			__m256 epsilon = _mm256_set1_ps(FLT_EPSILON);
+			__m256 one = _mm256_set1_ps(1.f);
+			for (; i + 8 < point_count; i += 8) {
+				__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i + 1), _mm256_loadu_ps(x + i - 1));
+				__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i + 1), _mm256_loadu_ps(y + i - 1));
+				__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i + 1), _mm256_loadu_ps(z + i - 1));
+				if (normalize) {
+					__m256 norm = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+					//the tangents that are too small are divided by 1, i.e. left as they are
+					__m256 divisor = _mm256_blendv_ps(one, norm, _mm256_cmp_ps(norm, epsilon, _CMP_GT_OQ));
+					dx = _mm256_div_ps(dx, divisor);
+					dy = _mm256_div_ps(dy, divisor);
+					dz = _mm256_div_ps(dz, divisor);
+				}
+				_mm256_storeu_ps(tx + i, dx);
+				_mm256_storeu_ps(ty + i, dy);
+				_mm256_storeu_ps(tz + i, dz);
+			}
+#endif
+			for (; i < point_count - 1; i++) {
+				set_tangent(x, y, z, tx, ty, tz, i, i - 1, i + 1, normalize);
+			}
+			set_tangent(x, y, z, tx, ty, tz, point_count - 1, point_count - 2, point_count - 1, normalize);
+		}
+
+		/** Index of the point of [start, end] furthest from the line (from, to) and its distance in max_distance
+		(see DiscreteCurve::furthest_point_to_line_index). When from and to are (almost) the same point, the distance
+		to that point is used instead. The range must be valid*/
+		inline GRuint furthest_point_to_line_index(const GRfloat* x, const GRfloat* y, const GRfloat* z,
+			GRuint start, GRuint end, Vector3f from, Vector3f to, GRfloat& max_distance) {
+
+			//|(p - from) x (p - to)| / |to - from|, compared squared and without the constant division
+			GRfloat line_length = (to - from).norm();
+			bool degenerate = line_length <= FLT_EPSILON;
+			GRfloat best_value(-1.f);
+			GRuint best_index(start);
+
+			GRuint i(start);
+#ifdef __AVX2__
+			__m256 best_values = _mm256_set1_ps(-1.f);
+			__m256i best_indices = _mm256_set1_epi32(-1);
+			__m256i indices = _mm256_add_epi32(_mm256_set1_epi32((std::int32_t)start), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+			__m256i eight = _mm256_set1_epi32(8);
+			__m256 fx = _mm256_set1_ps(from.X()), fy = _mm256_set1_ps(from.Y()), fz = _mm256_set1_ps(from.Z());
+			__m256 tx = _mm256_set1_ps(to.X()), ty = _mm256_set1_ps(to.Y()), tz = _mm256_set1_ps(to.Z());
+			for (; i + 8 <= end + 1; i += 8) {
+				__m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+				__m256 ax = _mm256_sub_ps(px, fx), ay = _mm256_sub_ps(py, fy), az = _mm256_sub_ps(pz, fz);
+				__m256 value;
+				if (degenerate) {
+					value = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, ax), _mm256_mul_ps(ay, ay)), _mm256_mul_ps(az, az));
+				}
+				else {
+					__m256 bx = _mm256_sub_ps(px, tx), by = _mm256_sub_ps(py, ty), bz = _mm256_sub_ps(pz, tz);
+					__m256 cx = _mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(az, by));
+					__m256 cy = _mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(ax, bz));
+					__m256 cz = _mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(ay, bx));
+					value = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+				}
+				__m256 better = _mm256_cmp_ps(value, best_values, _CMP_GT_OQ);
+				best_values = _mm256_blendv_ps(best_values, value, better);
+				best_indices = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_indices), _mm256_castsi256_ps(indices), better));
+				indices = _mm256_add_epi32(indices, eight);
+			}
+			reduce_lanes(best_values, best_indices, best_value, best_index, [](GRfloat a, GRfloat b) { return a > b; });
+#endif
+			for (; i <= end; i++) {
+				GRfloat ax = x[i] - from.X(), ay = y[i] - from.Y(), az = z[i] - from.Z();
+				GRfloat value;
+				if (degenerate) {
+					value = ax * ax + ay * ay + az * az;
+				}
+				else {
+					GRfloat bx = x[i] - to.X(), by = y[i] - to.Y(), bz = z[i] - to.Z();
+					GRfloat cx = ay * bz - az * by;
+					GRfloat cy = az * bx - ax * bz;
+					GRfloat cz = ax * by - ay * bx;
+					value = cx * cx + cy * cy + cz * cz;
+				}
+				if (value > best_value) {
+					best_value = value;
+					best_index = i;
+				}
+			}
+
+			max_distance = degenerate ? sqrtf(best_value) : sqrtf(best_value) / line_length;
+			return best_index;
+		}
+
+		/** Index of the point of [start, end] nearest to 'point' (see DiscreteCurve::nearest_point_index). The range must be valid*/
+		inline GRuint nearest_point_index(const GRfloat* x, const GRfloat* y, const GRfloat* z,
+			GRuint start, GRuint end, Vector3f point) {
+
+			GRfloat best_value(std::numeric_limits<GRfloat>::max());
+			GRuint best_index(start);
+
+			GRuint i(start);
+#ifdef __AVX2__
+			__m256 best_values = _mm256_set1_ps(std::numeric_limits<GRfloat>::max());
+			__m256i best_indices = _mm256_set1_epi32(-1);
+			__m256i indices = _mm256_add_epi32(_mm256_set1_epi32((std::int32_t)start), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+			__m256i eight = _mm256_set1_epi32(8);
+			__m256 qx = _mm256_set1_ps(point.X()), qy = _mm256_set1_ps(point.Y()), qz = _mm256_set1_ps(point.Z());
+			for (; i + 8 <= end + 1; i += 8) {
+				__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), qx);
+				__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), qy);
+				__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), qz);
+				__m256 value = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+				__m256 better = _mm256_cmp_ps(value, best_values, _CMP_LT_OQ);
+				best_values = _mm256_blendv_ps(best_values, value, better);
+				best_indices = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_indices), _mm256_castsi256_ps(indices), better));
+				indices = _mm256_add_epi32(indices, eight);
+			}
+			reduce_lanes(best_values, best_indices, best_value, best_index, [](GRfloat a, GRfloat b) { return a < b; });
+#endif
+			for (; i <= end; i++) {
+				GRfloat dx = x[i] - point.X(), dy = y[i] - point.Y(), dz = z[i] - point.Z();
+				GRfloat value = dx * dx + dy * dy + dz * dz;
+				if (value < best_value) {
+					best_value = value;
+					best_index = i;
+				}
+			}
+			return best_index;
+		}
+
+		/** Evaluates piecewise cubic polynomials p(u) = a + u (b + u (c + u d)) (see HermiteSegment).
+		coefficients[4 * coordinate + k] is the array of the k-th coefficient (a, b, c then d) of that coordinate over
+		the segments. Sample i is segment segments[i] at u[i] : its position goes to (x, y, z) and, if tx is not null,
+		its derivative to (tx, ty, tz)*/
+		inline void cubic_evaluate(const GRfloat* const* coefficients, const std::int32_t* segments, const GRfloat* u, GRuint count,
+			GRfloat* x, GRfloat* y, GRfloat* z, GRfloat* tx = nullptr, GRfloat* ty = nullptr, GRfloat* tz = nullptr) {
+			GRfloat* positions[3] = { x, y, z };
+			GRfloat* derivatives[3] = { tx, ty, tz };
+			GRuint i(0);
+#ifdef __AVX2__
+			__m256 two = _mm256_set1_ps(2.f);
+			__m256 three = _mm256_set1_ps(3.f);
+			for (; i + 8 <= count; i += 8) {
+				__m256i segment = _mm256_loadu_si256((const __m256i*)(segments + i));
+				__m256 parameter = _mm256_loadu_ps(u + i);
+				for (GRuint c(0); c < 3; c++) {
+					__m256 a = _mm256_i32gather_ps(coefficients[4 * c], segment, 4);
+					__m256 b = _mm256_i32gather_ps(coefficients[4 * c + 1], segment, 4);
+					__m256 c2 = _mm256_i32gather_ps(coefficients[4 * c + 2], segment, 4);
+					__m256 d = _mm256_i32gather_ps(coefficients[4 * c + 3], segment, 4);
+					__m256 position = _mm256_add_ps(c2, _mm256_mul_ps(d, parameter));
+					position = _mm256_add_ps(b, _mm256_mul_ps(position, parameter));
+					position = _mm256_add_ps(a, _mm256_mul_ps(position, parameter));
+					_mm256_storeu_ps(positions[c] + i, position);
+					if (tx) {
+						__m256 derivative = _mm256_add_ps(_mm256_mul_ps(c2, two), _mm256_mul_ps(d, _mm256_mul_ps(three, parameter)));
+						derivative = _mm256_add_ps(b, _mm256_mul_ps(derivative, parameter));
+						_mm256_storeu_ps(derivatives[c] + i, derivative);
+					}
+				}
+			}
+#endif
+			for (; i < count; i++) {
+				std::int32_t segment = segments[i];
+				GRfloat parameter = u[i];
+				for (GRuint c(0); c < 3; c++) {
+					GRfloat a = coefficients[4 * c][segment];
+					GRfloat b = coefficients[4 * c + 1][segment];
+					GRfloat c2 = coefficients[4 * c + 2][segment];
+					GRfloat d = coefficients[4 * c + 3][segment];
+					positions[c][i] = a + (b + (c2 + d * parameter) * parameter) * parameter;
+					if (tx) {
+						derivatives[c][i] = b + (c2 * 2.f + d * (3.f * parameter)) * parameter;
+					}
+				}
+			}
+		}
+	}
+}
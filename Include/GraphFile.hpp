@@ -0,0 +1,322 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "GrapholonTypes.hpp"
+
+namespace grapholon {
+
+	/** A read-only view of a whole file mapped in memory*/
+	class MappedFile {
+	private:
+		const char* data_ = nullptr;
+		size_t size_ = 0;
+
+#ifdef _WIN32
+		HANDLE file_ = INVALID_HANDLE_VALUE;
+		HANDLE mapping_ = NULL;
+#else
+		int file_ = -1;
+#endif
+
+	public:
+		MappedFile() {}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile() {
+			close();
+		}
+
+		/** Returns false if the file could not be opened or mapped. An empty file is opened but not mapped*/
+		bool open(const std::string& filename) {
+			close();
+#ifdef _WIN32
+			file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (file_ == INVALID_HANDLE_VALUE) {
+				return false;
+			}
+			LARGE_INTEGER file_size;
+			if (!GetFileSizeEx(file_, &file_size)) {
+				close();
+				return false;
+			}
+			size_ = (size_t)file_size.QuadPart;
+			if (!size_) {
+				return true;
+			}
+			mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping_ == NULL) {
+				close();
+				return false;
+			}
+			data_ = (const char*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+#else
+			file_ = ::open(filename.c_str(), O_RDONLY);
+			if (file_ < 0) {
+				return false;
+			}
+			struct stat file_stat;
+			if (fstat(file_, &file_stat) != 0) {
+				close();
+				return false;
+			}
+			size_ = (size_t)file_stat.st_size;
+			if (!size_) {
+				return true;
+			}
+			void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_, 0);
+			data_ = mapped == MAP_FAILED ? nullptr : (const char*)mapped;
+#endif
+			if (data_ == nullptr) {
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		void close() {
+#ifdef _WIN32
+			if (data_ != nullptr) {
+				UnmapViewOfFile(data_);
+			}
+			if (mapping_ != NULL) {
+				CloseHandle(mapping_);
+				mapping_ = NULL;
+			}
+			if (file_ != INVALID_HANDLE_VALUE) {
+				CloseHandle(file_);
+				file_ = INVALID_HANDLE_VALUE;
+			}
+#else
+			if (data_ != nullptr) {
+				munmap((void*)data_, size_);
+			}
+			if (file_ >= 0) {
+				::close(file_);
+				file_ = -1;
+			}
+#endif
+			data_ = nullptr;
+			size_ = 0;
+		}
+
+		const char* data() const {
+			return data_;
+		}
+
+		size_t size() const {
+			return size_;
+		}
+	};
+
+
+	/************************************************************************************************ Binary graph file format */
+
+	/** Layout of a binary graph file (all values little-endian, every table aligned on 8 bytes) :
+	 - a GraphFileHeader
+	 - the vertex table : vertex_count GraphFileVertex
+	 - the edge table : edge_count GraphFileEdge
+	 - the point blob : point_count times 3 GRfloat (x, y, z). Each edge owns a contiguous range of it
+	The curves' tangents are not stored, they are recomputed from the points when loading (like the text format).
+	The tables are written and mapped as they are in memory, so binary graph files can only be written and read
+	on little-endian hosts : the writer and the view refuse to work on big-endian ones*/
+
+#define GRAPH_FILE_MAGIC "GRPHLNB"
+#define GRAPH_FILE_VERSION 1
+
+#define GRAPH_FILE_CYCLE_FLAG 1u
+
+	struct GraphFileHeader {
+		char magic[8];
+		std::uint32_t version;
+		GRfloat scale;
+		std::uint32_t vertex_count;
+		std::uint32_t edge_count;
+		std::uint64_t point_count;
+		std::uint64_t vertex_table_offset;
+		std::uint64_t edge_table_offset;
+		std::uint64_t point_blob_offset;
+	};
+
+	struct GraphFileVertex {
+		GRfloat position[3];
+		GRfloat radius;
+		std::uint32_t flags;
+	};
+
+	struct GraphFileEdge {
+		std::uint32_t source;
+		std::uint32_t target;
+		std::uint32_t flags;
+		std::uint32_t point_count;
+		std::uint64_t first_point;
+	};
+
+	static_assert(sizeof(GraphFileHeader) == 56, "unexpected padding in GraphFileHeader");
+	static_assert(sizeof(GraphFileVertex) == 20, "unexpected padding in GraphFileVertex");
+	static_assert(sizeof(GraphFileEdge) == 24, "unexpected padding in GraphFileEdge");
+
+	/** The content of a graph file as three plain arrays*/
+	struct GraphTables {
+		GRfloat scale = 1.f;
+		std::vector<GraphFileVertex> vertices;
+		std::vector<GraphFileEdge> edges;
+		std::vector<GRfloat> points;///<x, y, z of each point
+	};
+
+	inline bool graph_file_host_is_little_endian() {
+		const std::uint32_t one = 1;
+		unsigned char first_byte;
+		std::memcpy(&first_byte, &one, 1);
+		return first_byte == 1;
+	}
+
+	inline std::uint64_t graph_file_align(std::uint64_t offset) {
+		return (offset + 7) & ~(std::uint64_t)7;
+	}
+
+
+	/** Writes the three tables in a binary graph file. Returns false if the file could not be written
+	(or if the host is big-endian)*/
+	inline bool write_graph_file(const std::string& filename, GRfloat scale,
+		const std::vector<GraphFileVertex>& vertices,
+		const std::vector<GraphFileEdge>& edges,
+		const std::vector<GRfloat>& points) {
+		if (!graph_file_host_is_little_endian()) {
+			return false;
+		}
+
+		GraphFileHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+		header.version = GRAPH_FILE_VERSION;
+		header.scale = scale;
+		header.vertex_count = (std::uint32_t)vertices.size();
+		header.edge_count = (std::uint32_t)edges.size();
+		header.point_count = points.size() / 3;
+		header.vertex_table_offset = graph_file_align(sizeof(GraphFileHeader));
+		header.edge_table_offset = graph_file_align(header.vertex_table_offset + vertices.size() * sizeof(GraphFileVertex));
+		header.point_blob_offset = graph_file_align(header.edge_table_offset + edges.size() * sizeof(GraphFileEdge));
+
+		std::ofstream output_file(filename.c_str(), std::ios::binary);
+		if (!output_file.is_open()) {
+			return false;
+		}
+
+		const char padding[8] = { 0 };
+		auto write_table = [&](const void* data, std::uint64_t byte_size, std::uint64_t offset) {
+			std::uint64_t position = (std::uint64_t)output_file.tellp();
+			output_file.write(padding, (std::streamsize)(offset - position));
+			output_file.write((const char*)data, (std::streamsize)byte_size);
+		};
+
+		output_file.write((const char*)&header, sizeof(header));
+		write_table(vertices.data(), vertices.size() * sizeof(GraphFileVertex), header.vertex_table_offset);
+		write_table(edges.data(), edges.size() * sizeof(GraphFileEdge), header.edge_table_offset);
+		write_table(points.data(), points.size() * sizeof(GRfloat), header.point_blob_offset);
+
+		return output_file.good();
+	}
+
+
+	/** Maps a binary graph file and gives direct access to its tables (nothing is copied)*/
+	class GraphFileView {
+	private:
+		MappedFile file_;
+		const GraphFileHeader* header_ = nullptr;
+
+	public:
+		/** Throws a std::runtime_error if the file cannot be mapped or is not a valid binary graph file,
+		or if the host is big-endian*/
+		void open(const std::string& filename) {
+			header_ = nullptr;
+			if (!graph_file_host_is_little_endian()) {
+				throw std::runtime_error("ERROR - Binary graph files can only be read on little-endian hosts");
+			}
+			if (!file_.open(filename)) {
+				throw std::runtime_error("ERROR - Could not open specified file");
+			}
+			if (file_.size() < sizeof(GraphFileHeader)) {
+				throw std::runtime_error("ERROR - File is too small to be a binary graph file");
+			}
+
+			const GraphFileHeader* header = (const GraphFileHeader*)file_.data();
+			if (std::memcmp(header->magic, GRAPH_FILE_MAGIC, sizeof(header->magic)) != 0) {
+				throw std::runtime_error("ERROR - File is not a binary graph file");
+			}
+			if (header->version != GRAPH_FILE_VERSION) {
+				throw std::runtime_error("ERROR - Unsupported binary graph file version " + std::to_string(header->version));
+			}
+
+			auto table_fits = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t element_size) {
+				return offset % 8 == 0
+					&& offset <= file_.size()
+					&& count <= (file_.size() - offset) / element_size;
+			};
+			if (!table_fits(header->vertex_table_offset, header->vertex_count, sizeof(GraphFileVertex))
+				|| !table_fits(header->edge_table_offset, header->edge_count, sizeof(GraphFileEdge))
+				|| !table_fits(header->point_blob_offset, header->point_count, 3 * sizeof(GRfloat))) {
+				throw std::runtime_error("ERROR - Binary graph file is truncated or corrupted");
+			}
+
+			header_ = header;
+		}
+
+		const GraphFileHeader& header() const {
+			return *header_;
+		}
+
+		const GraphFileVertex* vertices() const {
+			return (const GraphFileVertex*)(file_.data() + header_->vertex_table_offset);
+		}
+
+		const GraphFileEdge* edges() const {
+			return (const GraphFileEdge*)(file_.data() + header_->edge_table_offset);
+		}
+
+		/** x, y, z of each point*/
+		const GRfloat* points() const {
+			return (const GRfloat*)(file_.data() + header_->point_blob_offset);
+		}
+	};
+}
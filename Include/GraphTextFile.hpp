@@ -0,0 +1,741 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "GrapholonTypes.hpp"
+#include "Compression.hpp"
+#include "GraphFile.hpp"
+#include "Logger.hpp"
+#include "Parallel.hpp"
+#include "Vector.hpp"
+
+namespace grapholon {
+
+	/** Below this many bytes per thread, the <edges> section is not worth splitting*/
+#define MIN_PARALLEL_PARSING_CHUNK_SIZE (1 << 20)
+
+	/** Size of the buffer of the GraphTextWriter (and of the compressed blocks)*/
+#define TEXT_WRITER_BUFFER_SIZE (1 << 20)
+
+	/************************************************************************************************ Number parsing */
+
+	/** Both parsers skip leading spaces and tabs, advance 'cursor' past the number and return false
+	(leaving 'cursor' untouched) if no number could be read before 'end'*/
+
+	inline bool parse_uint(const char*& cursor, const char* end, GRuint& value) {
+		const char* c = cursor;
+		while (c < end && (*c == ' ' || *c == '\t')) {
+			c++;
+		}
+		if (c == end || *c < '0' || *c > '9') {
+			return false;
+		}
+		std::uint64_t result(0);
+		while (c < end && *c >= '0' && *c <= '9') {
+			result = result * 10 + (std::uint64_t)(*c - '0');
+			if (result > 0xFFFFFFFFull) {
+				return false;
+			}
+			c++;
+		}
+		value = (GRuint)result;
+		cursor = c;
+		return true;
+	}
+
+	/** Numbers with up to 19 significant digits and small exponents (i.e. the ones written by std::ostream) are computed
+	directly in double precision, other numbers (long mantissas, large exponents, inf, nan) fall back to strtod*/
+	inline bool parse_float(const char*& cursor, const char* end, GRfloat& value) {
+		static const double powers_of_ten[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		const char* c = cursor;
+		while (c < end && (*c == ' ' || *c == '\t')) {
+			c++;
+		}
+		const char* start = c;
+
+		bool negative(false);
+		if (c < end && (*c == '-' || *c == '+')) {
+			negative = *c == '-';
+			c++;
+		}
+		const char* digits_start = c;
+
+		std::uint64_t mantissa(0);
+		GRint exponent(0);
+		GRuint digit_count(0);
+		bool exact(true);
+
+		while (c < end && *c >= '0' && *c <= '9') {
+			if (digit_count < 19) {
+				mantissa = mantissa * 10 + (std::uint64_t)(*c - '0');
+				if (mantissa) {
+					digit_count++;
+				}
+			}
+			else {
+				exponent++;
+				exact = false;
+			}
+			c++;
+		}
+		const char* integer_end = c;
+
+		GRuint fraction_length(0);
+		if (c < end && *c == '.') {
+			c++;
+			while (c < end && *c >= '0' && *c <= '9') {
+				if (digit_count < 19) {
+					mantissa = mantissa * 10 + (std::uint64_t)(*c - '0');
+					exponent--;
+					if (mantissa) {
+						digit_count++;
+					}
+				}
+				else {
+					exact = false;
+				}
+				fraction_length++;
+				c++;
+			}
+		}
+
+		if (integer_end == digits_start && fraction_length == 0) {
+			//no digits : maybe inf or nan
+			char* strtod_end = nullptr;
+			std::string text(start, (size_t)std::min<std::ptrdiff_t>(end - start, 16));
+			double result = strtod(text.c_str(), &strtod_end);
+			if (strtod_end == text.c_str()) {
+				return false;
+			}
+			value = (GRfloat)result;
+			cursor = start + (strtod_end - text.c_str());
+			return true;
+		}
+
+		if (c < end && (*c == 'e' || *c == 'E')) {
+			const char* exponent_start = c;
+			c++;
+			bool negative_exponent(false);
+			if (c < end && (*c == '-' || *c == '+')) {
+				negative_exponent = *c == '-';
+				c++;
+			}
+			if (c < end && *c >= '0' && *c <= '9') {
+				GRint explicit_exponent(0);
+				while (c < end && *c >= '0' && *c <= '9') {
+					if (explicit_exponent < 100000) {
+						explicit_exponent = explicit_exponent * 10 + (*c - '0');
+					}
+					c++;
+				}
+				exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+			}
+			else {
+				//not an exponent after all
+				c = exponent_start;
+			}
+		}
+
+		double result;
+		if (exact && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22) {
+			//both the mantissa and the power of ten are exact doubles so there is a single rounding
+			result = exponent < 0 ? (double)mantissa / powers_of_ten[-exponent] : (double)mantissa * powers_of_ten[exponent];
+			if (negative) {
+				result = -result;
+			}
+		}
+		else {
+			std::string text(start, c);
+			result = strtod(text.c_str(), nullptr);
+		}
+
+		value = (GRfloat)result;
+		cursor = c;
+		return true;
+	}
+
+
+	/************************************************************************************************ Number formatting */
+
+	/** Writes the unsigned integer in 'output' (at least 10 chars) and returns the number of characters written*/
+	inline GRuint format_uint(GRuint value, char* output) {
+		char digits[10];
+		GRuint count(0);
+		do {
+			digits[count++] = (char)('0' + value % 10);
+			value /= 10;
+		} while (value);
+		for (GRuint i(0); i < count; i++) {
+			output[i] = digits[count - 1 - i];
+		}
+		return count;
+	}
+
+	/** Writes the shortest decimal representation of the value that parse_float() reads back exactly.
+	'output' must hold at least 16 chars. Returns the number of characters written*/
+	inline GRuint format_float(GRfloat value, char* output) {
+		if (value != value) {
+			std::memcpy(output, "nan", 3);
+			return 3;
+		}
+
+		GRuint length(0);
+		if (std::signbit(value)) {
+			output[length++] = '-';
+			value = -value;
+		}
+		if (std::isinf(value)) {
+			std::memcpy(output + length, "inf", 3);
+			return length + 3;
+		}
+
+		//integers are by far the most common values in our files
+		if (value < 1e7f && value == (GRfloat)(GRuint)value) {
+			return length + format_uint((GRuint)value, output + length);
+		}
+
+		static const double powers_of_ten[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		auto scale = [](double x, GRint power) {
+			if (power >= -22 && power <= 22) {
+				return power < 0 ? x / powers_of_ten[-power] : x * powers_of_ten[power];
+			}
+			return x * std::pow(10.0, power);
+		};
+
+		//the 9 most significant digits (which are always enough for a float) and the exponent of the first one
+		GRint exponent = (GRint)std::floor(std::log10((double)value));
+		std::uint64_t mantissa_9 = (std::uint64_t)std::llround(scale((double)value, 8 - exponent));
+		if (mantissa_9 >= 1000000000ull) {
+			exponent++;
+			mantissa_9 = (std::uint64_t)std::llround(scale((double)value, 8 - exponent));
+		}
+		else if (mantissa_9 < 100000000ull) {
+			exponent--;
+			mantissa_9 = (std::uint64_t)std::llround(scale((double)value, 8 - exponent));
+		}
+
+		//then take fewer of them when they are enough to read the value back exactly, with the same computation as parse_float()
+		std::uint64_t mantissa(mantissa_9);
+		GRint digit_exponent(exponent);
+		std::uint64_t divisor(100000000ull);
+		for (GRint precision(1); precision <= 9; precision++, divisor /= 10) {
+			std::uint64_t candidate = (mantissa_9 + divisor / 2) / divisor;
+			GRint candidate_exponent(exponent);
+			if (candidate == (std::uint64_t)powers_of_ten[precision]) {
+				//rounding up to the next power of ten (e.g. 9.99 -> 10)
+				candidate /= 10;
+				candidate_exponent++;
+			}
+			GRint power = candidate_exponent - (precision - 1);
+			if ((GRfloat)scale((double)candidate, power) == value) {
+				mantissa = candidate;
+				digit_exponent = candidate_exponent;
+				break;
+			}
+		}
+
+		char digits[20];
+		GRuint digit_count = format_uint((GRuint)mantissa, digits);
+		while (digit_count > 1 && digits[digit_count - 1] == '0') {
+			digit_count--;
+		}
+
+		char* text = output + length;
+		GRuint text_length(0);
+		if (digit_exponent >= 0 && digit_exponent < 9) {
+			//fixed notation
+			for (GRuint i(0); i < digit_count || (GRint)i <= digit_exponent; i++) {
+				if ((GRint)i == digit_exponent + 1) {
+					text[text_length++] = '.';
+				}
+				text[text_length++] = i < digit_count ? digits[i] : '0';
+			}
+		}
+		else if (digit_exponent < 0 && digit_exponent >= -5) {
+			text[text_length++] = '0';
+			text[text_length++] = '.';
+			for (GRint i(-1); i > digit_exponent; i--) {
+				text[text_length++] = '0';
+			}
+			std::memcpy(text + text_length, digits, digit_count);
+			text_length += digit_count;
+		}
+		else {
+			//scientific notation
+			text[text_length++] = digits[0];
+			if (digit_count > 1) {
+				text[text_length++] = '.';
+				std::memcpy(text + text_length, digits + 1, digit_count - 1);
+				text_length += digit_count - 1;
+			}
+			text[text_length++] = 'e';
+			if (digit_exponent < 0) {
+				text[text_length++] = '-';
+			}
+			text_length += format_uint((GRuint)(digit_exponent < 0 ? -digit_exponent : digit_exponent), text + text_length);
+		}
+
+		//outside of the exact powers of ten, the check above may disagree with parse_float() : read the text back
+		GRint power = digit_exponent - (GRint)(digit_count - 1);
+		if (power < -22 || power > 22) {
+			const char* cursor = text;
+			GRfloat read_back;
+			if (!parse_float(cursor, text + text_length, read_back) || read_back != value) {
+				GRint fallback_length = snprintf(text, 16, "%.9g", (double)value);
+				text_length = (GRuint)fallback_length;
+			}
+		}
+
+		return length + text_length;
+	}
+
+
+	/************************************************************************************************ Text graph file writing */
+
+	/** Writes to a file through a large reusable buffer, optionally compressing each full buffer (see Compression.hpp)*/
+	class GraphTextWriter {
+	private:
+		std::ofstream file_;
+		std::vector<char> buffer_;
+		std::vector<char> compressed_;
+		bool compress_ = false;
+
+		void flush_buffer() {
+			if (!buffer_.size()) {
+				return;
+			}
+			if (compress_) {
+				compressed_.clear();
+				lz_append_block(buffer_.data(), buffer_.size(), compressed_);
+				file_.write(compressed_.data(), (std::streamsize)compressed_.size());
+			}
+			else {
+				file_.write(buffer_.data(), (std::streamsize)buffer_.size());
+			}
+			buffer_.clear();
+		}
+
+		/** Makes sure that 'size' more chars fit in the buffer*/
+		void reserve(size_t size) {
+			if (buffer_.size() + size > buffer_.capacity()) {
+				flush_buffer();
+			}
+		}
+
+	public:
+		GraphTextWriter() {
+			buffer_.reserve(TEXT_WRITER_BUFFER_SIZE);
+		}
+
+		~GraphTextWriter() {
+			close();
+		}
+
+		bool open(const std::string& filename, bool compress = false) {
+			close();
+			file_.open(filename.c_str(), std::ios::binary);
+			compress_ = compress;
+			if (file_.is_open() && compress_) {
+				compressed_.clear();
+				lz_begin_stream(compressed_);
+				file_.write(compressed_.data(), (std::streamsize)compressed_.size());
+			}
+			return file_.is_open();
+		}
+
+		/** Returns false if anything could not be written*/
+		bool close() {
+			if (!file_.is_open()) {
+				return true;
+			}
+			flush_buffer();
+			if (compress_) {
+				compressed_.clear();
+				lz_end_stream(compressed_);
+				file_.write(compressed_.data(), (std::streamsize)compressed_.size());
+			}
+			bool success = file_.good();
+			file_.close();
+			return success;
+		}
+
+		void write(const char* text, size_t size) {
+			if (size > TEXT_WRITER_BUFFER_SIZE) {
+				flush_buffer();
+				buffer_.insert(buffer_.end(), text, text + size);
+				flush_buffer();
+				return;
+			}
+			reserve(size);
+			buffer_.insert(buffer_.end(), text, text + size);
+		}
+
+		/** For string literals*/
+		template<size_t N>
+		void write(const char(&text)[N]) {
+			write(text, N - 1);
+		}
+
+		void write(const std::string& text) {
+			write(text.data(), text.size());
+		}
+
+		void write_uint(GRuint value) {
+			char text[10];
+			write(text, format_uint(value, text));
+		}
+
+		void write_float(GRfloat value) {
+			char text[32];
+			write(text, format_float(value, text));
+		}
+
+		/** Writes the three coordinates separated by spaces*/
+		void write_point(const Vector3f& point) {
+			char text[64];
+			GRuint length = format_float(point.X(), text);
+			text[length++] = ' ';
+			length += format_float(point.Y(), text + length);
+			text[length++] = ' ';
+			length += format_float(point.Z(), text + length);
+			write(text, length);
+		}
+	};
+
+
+	/************************************************************************************************ Text graph file parsing */
+
+	/** Parses the text format written by SkeletalGraph::export_to_file() into the tables of the binary format
+	(see GraphFile.hpp) so that both formats are loaded the same way.
+	Like the original line-by-line importer, unknown lines are ignored, errors are logged and
+	edges with invalid vertex indices are skipped*/
+	class GraphTextParser {
+	private:
+		const char* data_;
+		const char* end_;
+
+		static bool line_is(const char* line, const char* line_end, const char* text, size_t length) {
+			return (size_t)(line_end - line) == length && std::memcmp(line, text, length) == 0;
+		}
+
+		static bool line_starts_with(const char* line, const char* line_end, const char* text, size_t length) {
+			return (size_t)(line_end - line) >= length && std::memcmp(line, text, length) == 0;
+		}
+
+		/** Returns the end of the line starting at 'line' (without the '\r' of Windows line endings) and sets 'next' to the next line*/
+		const char* line_end(const char* line, const char*& next) const {
+			const char* new_line = (const char*)std::memchr(line, '\n', (size_t)(end_ - line));
+			const char* end = new_line ? new_line : end_;
+			next = new_line ? new_line + 1 : end_;
+			if (end > line && *(end - 1) == '\r') {
+				end--;
+			}
+			return end;
+		}
+
+#define GR_TAG(text) text, sizeof(text) - 1
+
+	public:
+		GraphTextParser(const char* data, size_t size) : data_(data), end_(data + size) {}
+
+		/** Counts the vertices, edges and (an upper bound of) the curve points so that the tables can be allocated once*/
+		void pre_scan(GRuint& vertex_count, GRuint& edge_count, std::uint64_t& point_count) const {
+			vertex_count = 0;
+			edge_count = 0;
+			point_count = 0;
+
+			const char* next = data_;
+			while (next < end_) {
+				const char* line = next;
+				const char* end = line_end(line, next);
+				if (line < end && *line == '<') {
+					if (line_is(line, end, GR_TAG("<vertex>"))) {
+						vertex_count++;
+					}
+					else if (line_is(line, end, GR_TAG("<edge>"))) {
+						edge_count++;
+					}
+				}
+				else {
+					point_count++;
+				}
+			}
+		}
+
+		void reserve(GraphTables& tables) const {
+			GRuint vertex_count(0);
+			GRuint edge_count(0);
+			std::uint64_t point_count(0);
+			pre_scan(vertex_count, edge_count, point_count);
+
+			tables.vertices.reserve(tables.vertices.size() + vertex_count);
+			tables.edges.reserve(tables.edges.size() + edge_count);
+			tables.points.reserve(tables.points.size() + 3 * point_count);
+		}
+
+		/** Parses the whole buffer and appends the result to the tables (and to the edges' points)*/
+		void parse(GraphTables& tables) const {
+			reserve(tables);
+			parse_lines(tables, false, 0);
+		}
+
+		/** Parses a buffer that only contains a part of the <edges> section (i.e. a sequence of <edge> blocks).
+		The source and target indices are checked against vertex_count since the vertices are not in the buffer*/
+		void parse_edges(GraphTables& tables, GRuint vertex_count) const {
+			reserve(tables);
+			parse_lines(tables, true, vertex_count);
+		}
+
+	private:
+		void parse_lines(GraphTables& tables, bool edges_only, GRuint edges_vertex_count) const {
+			bool reading_vertices(false);
+			bool reading_edges(edges_only);
+			bool reading_vertex(false);
+			bool reading_edge(false);
+			bool reading_curve(false);
+
+			GraphFileVertex vertex;
+			GraphFileEdge edge;
+
+			const char* next = data_;
+			while (next < end_) {
+				const char* line = next;
+				const char* end = line_end(line, next);
+				const char* cursor = line;
+
+				if (reading_curve && line < end && *line != '<') {
+					GRfloat x(0.f), y(0.f), z(0.f);
+					if (parse_float(cursor, end, x) && parse_float(cursor, end, y) && parse_float(cursor, end, z)) {
+						tables.points.push_back(x);
+						tables.points.push_back(y);
+						tables.points.push_back(z);
+						edge.point_count++;
+					}
+					else {
+						GR_LOG_ERROR("could not curve point from line : " << std::string(line, end));
+					}
+				}
+				else if (line_starts_with(line, end, GR_TAG("<scale>"))) {
+					cursor += sizeof("<scale>") - 1;
+					parse_float(cursor, end, tables.scale);
+				}
+				else if (line_is(line, end, GR_TAG("<vertices>"))) {
+					reading_vertices = true;
+				}
+				else if (line_is(line, end, GR_TAG("</vertices>"))) {
+					reading_vertices = false;
+				}
+				else if (reading_vertices) {
+					if (line_is(line, end, GR_TAG("<vertex>"))) {
+						reading_vertex = true;
+						//same defaults as VertexProperties
+						vertex = { { 0.f, 0.f, 0.f }, 1.f, 0 };
+					}
+					else if (line_is(line, end, GR_TAG("</vertex>"))) {
+						reading_vertex = false;
+						tables.vertices.push_back(vertex);
+					}
+					else if (reading_vertex) {
+						if (line_starts_with(line, end, GR_TAG("<pos>"))) {
+							cursor += sizeof("<pos>") - 1;
+							if (!(parse_float(cursor, end, vertex.position[0])
+								&& parse_float(cursor, end, vertex.position[1])
+								&& parse_float(cursor, end, vertex.position[2]))) {
+								GR_LOG_ERROR("could not read position from line : " << std::string(line, end));
+								vertex.position[0] = vertex.position[1] = vertex.position[2] = 0.f;
+							}
+						}
+						else if (line_starts_with(line, end, GR_TAG("<radius>"))) {
+							cursor += sizeof("<radius>") - 1;
+							if (!parse_float(cursor, end, vertex.radius)) {
+								GR_LOG_ERROR("could not read radius from line : " << std::string(line, end));
+								vertex.radius = 1.f;
+							}
+						}
+						else if (line_starts_with(line, end, GR_TAG("<cycle>"))) {
+							cursor += sizeof("<cycle>") - 1;
+							GRuint cycle(0);
+							if (!parse_uint(cursor, end, cycle)) {
+								GR_LOG_ERROR("could not read if in cycle from line : " << std::string(line, end));
+							}
+							vertex.flags = cycle ? GRAPH_FILE_CYCLE_FLAG : 0;
+						}
+					}
+				}
+				else if (line_is(line, end, GR_TAG("<edges>"))) {
+					reading_edges = true;
+					if (!tables.vertices.size()) {
+						break;
+					}
+				}
+				else if (line_is(line, end, GR_TAG("</edges>"))) {
+					reading_edges = false;
+				}
+				else if (reading_edges) {
+					if (line_is(line, end, GR_TAG("<edge>"))) {
+						reading_edge = true;
+						edge = { 0, 0, 0, 0, tables.points.size() / 3 };
+					}
+					else if (line_is(line, end, GR_TAG("</edge>"))) {
+						reading_edge = false;
+						GRuint vertex_count = edges_only ? edges_vertex_count : (GRuint)tables.vertices.size();
+						if (edge.source < vertex_count && edge.target < vertex_count) {
+							tables.edges.push_back(edge);
+						}
+						else {
+							GR_LOG_ERROR("could not add edge with invalid vertex indices : " << edge.source << ", " << edge.target);
+							tables.points.resize(3 * edge.first_point);
+						}
+					}
+					else if (reading_edge) {
+						if (line_is(line, end, GR_TAG("<curve>"))) {
+							reading_curve = true;
+						}
+						else if (line_is(line, end, GR_TAG("</curve>"))) {
+							reading_curve = false;
+						}
+						else if (line_starts_with(line, end, GR_TAG("<source>"))) {
+							cursor += sizeof("<source>") - 1;
+							if (!parse_uint(cursor, end, edge.source)) {
+								GR_LOG_ERROR("could not read source from line : " << std::string(line, end));
+							}
+						}
+						else if (line_starts_with(line, end, GR_TAG("<target>"))) {
+							cursor += sizeof("<target>") - 1;
+							if (!parse_uint(cursor, end, edge.target)) {
+								GR_LOG_ERROR("could not read target from line : " << std::string(line, end));
+							}
+						}
+						else if (line_starts_with(line, end, GR_TAG("<cycle>"))) {
+							cursor += sizeof("<cycle>") - 1;
+							GRuint cycle(0);
+							if (parse_uint(cursor, end, cycle)) {
+								edge.flags = cycle ? GRAPH_FILE_CYCLE_FLAG : 0;
+							}
+							else {
+								GR_LOG_ERROR("could not read cycle from line : " << std::string(line, end));
+							}
+						}
+					}
+				}
+			}
+		}
+
+		/** Returns the beginning of the first line starting at or after 'from' that is exactly 'text' (or end_ if there is none)*/
+		const char* find_line(const char* from, const char* text, size_t length) const {
+			//move to the beginning of the next line if we are in the middle of one
+			if (from > data_ && *(from - 1) != '\n') {
+				line_end(from, from);
+			}
+			const char* next = from;
+			while (next < end_) {
+				const char* line = next;
+				const char* end = line_end(line, next);
+				if (line_is(line, end, text, length)) {
+					return line;
+				}
+			}
+			return end_;
+		}
+
+	public:
+		/** Same result as parse() but the <edges> section is split at <edge> boundaries and parsed on several threads.
+		The chunks' edges and points are then appended in file order so the indices are the same as with parse().
+		A thread_count of 0 uses hardware_thread_count().
+		NOTE : the log sink may be called from several threads at once*/
+		void parse_parallel(GraphTables& tables, GRuint thread_count = 0) const {
+			if (!thread_count) {
+				thread_count = hardware_thread_count();
+			}
+
+			//the header and the vertices are parsed sequentially, up to the <edges> line
+			const char* edges_line = find_line(data_, GR_TAG("<edges>"));
+			const char* edges_start = edges_line;
+			if (edges_start < end_) {
+				line_end(edges_line, edges_start);
+			}
+
+			GRuint chunk_count = (GRuint)std::min<size_t>(thread_count, (size_t)(end_ - edges_start) / MIN_PARALLEL_PARSING_CHUNK_SIZE);
+			if (chunk_count <= 1) {
+				parse(tables);
+				return;
+			}
+
+			GraphTextParser(data_, (size_t)(edges_start - data_)).parse(tables);
+			if (!tables.vertices.size()) {
+				//same as parse() : no edges without vertices
+				return;
+			}
+
+			//split the rest at <edge> lines
+			std::vector<const char*> boundaries(chunk_count + 1, end_);
+			boundaries[0] = edges_start;
+			for (GRuint i(1); i < chunk_count; i++) {
+				const char* approximate_boundary = edges_start + (size_t)(end_ - edges_start) / chunk_count * i;
+				boundaries[i] = find_line(std::max(approximate_boundary, boundaries[i - 1]), GR_TAG("<edge>"));
+			}
+
+			GRuint vertex_count = (GRuint)tables.vertices.size();
+			std::vector<GraphTables> chunk_tables(chunk_count);
+			parallel_for(0, chunk_count, [&](GRuint chunk) {
+				GraphTextParser(boundaries[chunk], (size_t)(boundaries[chunk + 1] - boundaries[chunk])).parse_edges(chunk_tables[chunk], vertex_count);
+			}, chunk_count);
+
+			//and assemble the chunks in file order
+			size_t edge_count(tables.edges.size());
+			size_t point_value_count(tables.points.size());
+			for (auto& chunk : chunk_tables) {
+				edge_count += chunk.edges.size();
+				point_value_count += chunk.points.size();
+			}
+			tables.edges.reserve(edge_count);
+			tables.points.reserve(point_value_count);
+
+			for (auto& chunk : chunk_tables) {
+				std::uint64_t point_offset = tables.points.size() / 3;
+				for (auto& edge : chunk.edges) {
+					edge.first_point += point_offset;
+					tables.edges.push_back(edge);
+				}
+				tables.points.insert(tables.points.end(), chunk.points.begin(), chunk.points.end());
+				chunk = GraphTables();
+			}
+		}
+
+#undef GR_TAG
+	};
+}
@@ -22,6 +22,7 @@
 #pragma once
 
 using GRchar = char;
+using GRuchar = unsigned char;
 using GRuint = unsigned int;
 using GRint = int;
 using GRfloat = float;
@@ -0,0 +1,121 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+
+/** Log levels, from the least to the most verbose*/
+#define GRAPHOLON_LOG_LEVEL_NONE 0
+#define GRAPHOLON_LOG_LEVEL_ERROR 1
+#define GRAPHOLON_LOG_LEVEL_WARNING 2
+#define GRAPHOLON_LOG_LEVEL_INFO 3
+#define GRAPHOLON_LOG_LEVEL_DEBUG 4
+
+/** Messages above this level are not even compiled. Define it before including any grapholon header to change it
+(e.g. GRAPHOLON_LOG_LEVEL_NONE for production builds)*/
+#ifndef GRAPHOLON_LOG_LEVEL
+#ifdef NDEBUG
+#define GRAPHOLON_LOG_LEVEL GRAPHOLON_LOG_LEVEL_WARNING
+#else
+#define GRAPHOLON_LOG_LEVEL GRAPHOLON_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+namespace grapholon {
+
+	typedef int LogLevel;
+
+	/** Called with the level and the formatted message (without trailing new line) of each log entry*/
+	typedef std::function<void(LogLevel, const std::string&)> LogSink;
+
+	/** Routes the messages that pass both the compile-time (GRAPHOLON_LOG_LEVEL) and the runtime (Logger::set_level) levels to a sink.
+	The default sink writes errors and warnings to std::cerr and the rest to std::cout.
+	NOTE : use the GR_LOG_* macros rather than calling log() directly so that disabled messages are never formatted*/
+	class Logger {
+	private:
+		static LogLevel& runtime_level() {
+			static LogLevel level = GRAPHOLON_LOG_LEVEL_WARNING;
+			return level;
+		}
+
+		static LogSink& sink() {
+			static LogSink current_sink = default_sink;
+			return current_sink;
+		}
+
+	public:
+		static void default_sink(LogLevel level, const std::string& message) {
+			if (level <= GRAPHOLON_LOG_LEVEL_WARNING) {
+				std::cerr << message << std::endl;
+			}
+			else {
+				std::cout << message << std::endl;
+			}
+		}
+
+		static LogLevel level() {
+			return runtime_level();
+		}
+
+		static void set_level(LogLevel level) {
+			runtime_level() = level;
+		}
+
+		/** An empty sink discards everything*/
+		static void set_sink(LogSink new_sink) {
+			sink() = new_sink;
+		}
+
+		static void reset_sink() {
+			sink() = default_sink;
+		}
+
+		static bool is_enabled(LogLevel level) {
+			return level <= runtime_level() && sink();
+		}
+
+		static void log(LogLevel level, const std::string& message) {
+			if (is_enabled(level)) {
+				sink()(level, message);
+			}
+		}
+	};
+}
+
+/** The message can be anything that can be streamed into a std::ostream, e.g. GR_LOG_INFO("created " << n << " vertices")*/
+#define GR_LOG(level, message) \
+	do { \
+		if ((level) <= GRAPHOLON_LOG_LEVEL && grapholon::Logger::is_enabled(level)) { \
+			std::ostringstream grapholon_log_stream; \
+			grapholon_log_stream << message; \
+			grapholon::Logger::log(level, grapholon_log_stream.str()); \
+		} \
+	} while (0)
+
+#define GR_LOG_ERROR(message) GR_LOG(GRAPHOLON_LOG_LEVEL_ERROR, message)
+#define GR_LOG_WARNING(message) GR_LOG(GRAPHOLON_LOG_LEVEL_WARNING, message)
+#define GR_LOG_INFO(message) GR_LOG(GRAPHOLON_LOG_LEVEL_INFO, message)
+#define GR_LOG_DEBUG(message) GR_LOG(GRAPHOLON_LOG_LEVEL_DEBUG, message)
@@ -0,0 +1,102 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "GrapholonTypes.hpp"
+
+namespace grapholon {
+
+	/** Returns the number of threads the hardware can run concurrently (at least 1)*/
+	inline GRuint hardware_thread_count() {
+		GRuint count = (GRuint)std::thread::hardware_concurrency();
+		return count ? count : 1;
+	}
+
+	/** Splits [begin, end) in thread_count contiguous chunks of (almost) the same size and calls
+	function(chunk_begin, chunk_end, chunk_index) for each of them on its own thread.
+	The calling thread processes the first chunk. A thread_count of 0 uses hardware_thread_count().
+	The first exception thrown by a chunk is rethrown once all of them are done*/
+	template<typename Function>
+	void parallel_for_chunks(GRuint begin, GRuint end, Function function, GRuint thread_count = 0) {
+		if (end <= begin) {
+			return;
+		}
+		if (!thread_count) {
+			thread_count = hardware_thread_count();
+		}
+		GRuint count = end - begin;
+		if (thread_count > count) {
+			thread_count = count;
+		}
+
+		if (thread_count == 1) {
+			function(begin, end, 0);
+			return;
+		}
+
+		std::exception_ptr first_exception;
+		std::mutex exception_mutex;
+
+		auto run_chunk = [&](GRuint chunk_index) {
+			GRuint chunk_begin = begin + (GRuint)((unsigned long long)count * chunk_index / thread_count);
+			GRuint chunk_end = begin + (GRuint)((unsigned long long)count * (chunk_index + 1) / thread_count);
+			try {
+				function(chunk_begin, chunk_end, chunk_index);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(exception_mutex);
+				if (!first_exception) {
+					first_exception = std::current_exception();
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(thread_count - 1);
+		for (GRuint i(1); i < thread_count; i++) {
+			threads.push_back(std::thread(run_chunk, i));
+		}
+		run_chunk(0);
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		if (first_exception) {
+			std::rethrow_exception(first_exception);
+		}
+	}
+
+	/** Calls function(i) for every i in [begin, end), splitting the range between thread_count threads (see parallel_for_chunks)*/
+	template<typename Function>
+	void parallel_for(GRuint begin, GRuint end, Function function, GRuint thread_count = 0) {
+		parallel_for_chunks(begin, end, [&function](GRuint chunk_begin, GRuint chunk_end, GRuint) {
+			for (GRuint i(chunk_begin); i < chunk_end; i++) {
+				function(i);
+			}
+		}, thread_count);
+	}
+}
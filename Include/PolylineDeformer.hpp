@@ -0,0 +1,291 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "Curve.hpp"
+
+namespace grapholon {
+
+#define POLYLINE_ARAP_MAX_ITERATIONS 100
+#define POLYLINE_ARAP_TOLERANCE 1e-4
+
+	/** As-Rigid-As-Possible deformation of an open polyline, without going through a triangle mesh.
+	Each point i has a rotation R_i fitted to its (at most two) segments and the energy is the "spokes" one :
+		sum over the points i, sum over their neighbours j of || (p_i - p_j) - R_i (q_i - q_j) ||^2
+	with q the rest shape and p the deformed one. A point only has two neighbours so the system of the global step
+	is the tridiagonal Laplacian of the polyline : it is factorized once (Thomas algorithm) and each iteration
+	(local rotation fits + global solve) costs O(n)*/
+	class PolylineDeformer {
+	private:
+		std::vector<Eigen::Vector3d> rest_points_;
+		std::vector<bool> fixed_;
+		std::vector<GRuint> handles_;
+
+		/** Thomas factorization of the global step's matrix : rows are (lower_[i], 1/inverse_pivots_[i], ...)
+		and upper_factors_ holds the eliminated upper diagonal*/
+		std::vector<GRdouble> lower_;
+		std::vector<GRdouble> upper_factors_;
+		std::vector<GRdouble> inverse_pivots_;
+
+		std::vector<Eigen::Matrix3d> rotations_;
+		std::vector<Eigen::Vector3d> right_hand_side_;
+		std::vector<Eigen::Vector3d> solution_;
+
+		GRuint max_iterations_ = POLYLINE_ARAP_MAX_ITERATIONS;
+		GRdouble tolerance_ = POLYLINE_ARAP_TOLERANCE;
+		GRdouble average_length_ = 1.;
+
+		static Eigen::Vector3d to_eigen(const Vector3f& vec) {
+			return Eigen::Vector3d(vec.X(), vec.Y(), vec.Z());
+		}
+
+		/** Best rotation taking point i's rest spokes to its current ones*/
+		void fit_rotation(GRuint i, const std::vector<Eigen::Vector3d>& points) {
+			Eigen::Matrix3d covariance(Eigen::Matrix3d::Zero());
+			if (i > 0) {
+				covariance += (rest_points_[i] - rest_points_[i - 1]) * (points[i] - points[i - 1]).transpose();
+			}
+			if (i < rest_points_.size() - 1) {
+				covariance += (rest_points_[i] - rest_points_[i + 1]) * (points[i] - points[i + 1]).transpose();
+			}
+
+			Eigen::JacobiSVD<Eigen::Matrix3d> svd(covariance, Eigen::ComputeFullU | Eigen::ComputeFullV);
+			Eigen::Matrix3d U = svd.matrixU();
+			Eigen::Matrix3d rotation = svd.matrixV() * U.transpose();
+			//no reflections
+			if (rotation.determinant() < 0) {
+				U.col(2) *= -1.;
+				rotation = svd.matrixV() * U.transpose();
+			}
+			rotations_[i] = rotation;
+		}
+
+	public:
+		PolylineDeformer() {}
+
+		void set_max_iterations(GRuint max_iterations) {
+			max_iterations_ = max_iterations;
+		}
+
+		/** The iterations stop once no point moves by more than tolerance times the average segment length*/
+		void set_tolerance(GRdouble tolerance) {
+			tolerance_ = tolerance;
+		}
+
+		/** Factorizes the system for this rest shape and these fixed points. Returns false if there are less than
+		two points, no handle or a handle out of range*/
+		bool precompute(const std::vector<Vector3f>& rest_points, const std::vector<GRuint>& handles) {
+			GRuint point_count = (GRuint)rest_points.size();
+			rest_points_.clear();
+			handles_.clear();
+
+			if (point_count < 2 || !handles.size()) {
+				return false;
+			}
+
+			fixed_.assign(point_count, false);
+			for (auto handle : handles) {
+				if (handle >= point_count) {
+					return false;
+				}
+				fixed_[handle] = true;
+			}
+			handles_ = handles;
+
+			rest_points_.resize(point_count);
+			average_length_ = 0.;
+			for (GRuint i(0); i < point_count; i++) {
+				rest_points_[i] = to_eigen(rest_points[i]);
+				if (i > 0) {
+					average_length_ += (rest_points_[i] - rest_points_[i - 1]).norm();
+				}
+			}
+			average_length_ /= (GRdouble)(point_count - 1);
+
+			//row i of the Laplacian : 2 * (#neighbours * p_i - sum of p_j). Fixed rows are identity rows
+			lower_.assign(point_count, 0.);
+			upper_factors_.assign(point_count, 0.);
+			inverse_pivots_.assign(point_count, 0.);
+			for (GRuint i(0); i < point_count; i++) {
+				GRdouble diagonal(1.), lower(0.), upper(0.);
+				if (!fixed_[i]) {
+					lower = i > 0 ? -2. : 0.;
+					upper = i < point_count - 1 ? -2. : 0.;
+					diagonal = -(lower + upper);
+				}
+				GRdouble pivot = diagonal - (i > 0 ? lower * upper_factors_[i - 1] : 0.);
+				lower_[i] = lower;
+				inverse_pivots_[i] = 1. / pivot;
+				upper_factors_[i] = upper / pivot;
+			}
+
+			rotations_.assign(point_count, Eigen::Matrix3d::Identity());
+			right_hand_side_.resize(point_count);
+			solution_.resize(point_count);
+			return true;
+		}
+
+		bool is_precomputed() const {
+			return rest_points_.size() != 0;
+		}
+
+		size_t point_count() const {
+			return rest_points_.size();
+		}
+
+		/** Moves the handles to handle_positions (given in the order of precompute()'s handles) and deforms 'points'.
+		'points' is the initial guess : it is reset to the rest shape if it doesn't have the right size.
+		Returns the number of iterations done, 0 if the deformer was not precomputed*/
+		GRuint solve(const std::vector<Vector3f>& handle_positions, std::vector<Vector3f>& points) {
+			GRuint point_count = (GRuint)rest_points_.size();
+			if (!point_count || handle_positions.size() != handles_.size()) {
+				return 0;
+			}
+
+			if (points.size() != point_count) {
+				points.resize(point_count);
+				for (GRuint i(0); i < point_count; i++) {
+					points[i] = Vector3f((GRfloat)rest_points_[i].x(), (GRfloat)rest_points_[i].y(), (GRfloat)rest_points_[i].z());
+				}
+			}
+			for (GRuint i(0); i < point_count; i++) {
+				solution_[i] = to_eigen(points[i]);
+			}
+			for (GRuint h(0); h < handles_.size(); h++) {
+				solution_[handles_[h]] = to_eigen(handle_positions[h]);
+			}
+
+			GRdouble max_displacement_allowed = tolerance_ * average_length_;
+			GRuint iteration(0);
+			while (iteration < max_iterations_) {
+				iteration++;
+
+				//local step
+				for (GRuint i(0); i < point_count; i++) {
+					fit_rotation(i, solution_);
+				}
+
+				//global step : forward elimination then back substitution, for the 3 coordinates at once
+				for (GRuint i(0); i < point_count; i++) {
+					Eigen::Vector3d rhs;
+					if (fixed_[i]) {
+						rhs = solution_[i];
+					}
+					else {
+						rhs = Eigen::Vector3d::Zero();
+						if (i > 0) {
+							rhs += (rotations_[i] + rotations_[i - 1]) * (rest_points_[i] - rest_points_[i - 1]);
+						}
+						if (i < point_count - 1) {
+							rhs += (rotations_[i] + rotations_[i + 1]) * (rest_points_[i] - rest_points_[i + 1]);
+						}
+					}
+					if (i > 0) {
+						rhs -= lower_[i] * right_hand_side_[i - 1];
+					}
+					right_hand_side_[i] = rhs * inverse_pivots_[i];
+				}
+
+				GRdouble max_displacement(0.);
+				Eigen::Vector3d next = right_hand_side_[point_count - 1];
+				for (GRuint i(point_count); i-- > 0;) {
+					Eigen::Vector3d position = i == point_count - 1 ? next : Eigen::Vector3d(right_hand_side_[i] - upper_factors_[i] * next);
+					max_displacement = std::max(max_displacement, (position - solution_[i]).norm());
+					solution_[i] = position;
+					next = position;
+				}
+
+				if (max_displacement <= max_displacement_allowed) {
+					break;
+				}
+			}
+
+			for (GRuint i(0); i < point_count; i++) {
+				points[i] = Vector3f((GRfloat)solution_[i].x(), (GRfloat)solution_[i].y(), (GRfloat)solution_[i].z());
+			}
+			return iteration;
+		}
+
+		/** Computes the deformation of the curve when its control points move to their targets (the ends that are
+		not control points stay where they are) and stores it in 'points'. The curve's points are not modified but its
+		original shape, from which the deformation starts, is set if it is missing.
+		Returns false if the curve can't be deformed*/
+		static bool deform_curve_points(DeformableSplineCurve& in_curve, const std::vector<GRuint>& control_point_indices,
+			const std::vector<Vector3f>& target_positions, std::vector<Vector3f>& points) {
+			if (in_curve.size() < 2 || control_point_indices.size() != target_positions.size()) {
+				return false;
+			}
+
+			if (!in_curve.has_original_shape()) {
+				in_curve.set_original_shape();
+			}
+
+			GRuint last_index = (GRuint)in_curve.size() - 1;
+			std::vector<GRuint> handles = { 0, last_index };
+			std::vector<Vector3f> handle_positions = { in_curve.front().first, in_curve.back().first };
+			for (GRuint i(0); i < control_point_indices.size(); i++) {
+				GRuint index = control_point_indices[i];
+				if (index > last_index) {
+					return false;
+				}
+				if (index == 0) {
+					handle_positions[0] = target_positions[i];
+				}
+				else if (index == last_index) {
+					handle_positions[1] = target_positions[i];
+				}
+				else {
+					handles.push_back(index);
+					handle_positions.push_back(target_positions[i]);
+				}
+			}
+
+			PolylineDeformer deformer;
+			if (!deformer.precompute(in_curve.original_points(), handles)) {
+				return false;
+			}
+
+			points.clear();
+			return deformer.solve(handle_positions, points) != 0;
+		}
+
+		/** Same as CurveDeformer::deform_curve (both ends and the control point are fixed, the deformation starts
+		from the curve's original shape) but with the polyline solver. Returns false if the curve can't be deformed*/
+		static bool deform_curve(DeformableSplineCurve& in_curve, GRuint control_point_index, Vector3f target_position) {
+			std::vector<Vector3f> points;
+			if (!deform_curve_points(in_curve, { control_point_index }, { target_position }, points)) {
+				return false;
+			}
+
+			for (GRuint i(0); i < points.size(); i++) {
+				in_curve[i].first = points[i];
+			}
+			in_curve.update_tangents();
+			return true;
+		}
+	};
+}
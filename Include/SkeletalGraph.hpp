@@ -24,14 +24,22 @@
 #include "boost/graph/adjacency_list.hpp"
 #include "boost/graph/copy.hpp"
 
+#include <algorithm>
+#include <numeric>
 #include <queue>
 #include <set>
 #include <map>
+#include <unordered_map>
 
 #include <fstream>
 
 #include "Curve.hpp"
 #include "CurveDeformer.hpp"
+#include "PolylineDeformer.hpp"
+#include "Parallel.hpp"
+#include "SpatialIndex.hpp"
+#include "GraphFile.hpp"
+#include "GraphTextFile.hpp"
 
 //TODO : add sizes on each edge_to_collapse and vertex
 
@@ -81,6 +89,15 @@ namespace grapholon {
 
 	typedef std::pair<VertexDescriptor, EdgeVector> VertexNeighborhood;
 
+	typedef std::vector<EdgeVector> CycleBasis;
+
+	/** A point of an edge's curve moved to a new position (see SkeletalGraph::deform_edges)*/
+	struct EdgeDeformation {
+		EdgeDescriptor edge;
+		GRuint point_index;
+		Vector3f target_position;
+	};
+
 	/** This struct should eventually replace all return types of all operations.
 	The goal is to inform the caller of the SkeletalGraph methods of what changed during the method call*/
 	struct GraphOperationResult {
@@ -92,6 +109,38 @@ namespace grapholon {
 	};
 
 
+	/** The set of rules applied by SkeletalGraph::simplify(). Each rule is disabled by its default value*/
+	struct SimplificationRules {
+		std::vector<GRuint> degrees_to_remove;///<vertices of those degrees are removed along with their edges (see remove_vertices_of_degree)
+		GRfloat min_edge_length = 0.f;///<edges shorter than this are collapsed at their midpoint (see collapse_edges_shorter_than)
+		GRuint min_edge_spline_count = 0;///<edges with less points than this are collapsed at their midpoint (see collapse_edges_with_less_than_n_splines)
+		bool merge_degree_2_vertices = false;///<degree-2 vertices are removed and their edges merged (see remove_degree_2_vertex_and_merge_edges)
+	};
+
+	/** What SkeletalGraph::simplify() did*/
+	struct SimplificationResult {
+		GRuint removed_vertex_count = 0;///<vertices removed because of their degree
+		GRuint collapsed_edge_count = 0;
+		GRuint merged_vertex_count = 0;///<degree-2 vertices whose edges were merged
+	};
+
+	/** What the spatial index stores for each vertex (with a null edge) and each spline of an edge's curve*/
+	struct SpatialIndexEntry {
+		VertexDescriptor vertex;
+		EdgeDescriptor edge;
+		GRuint spline_index;///<the segment from curve[spline_index] to curve[spline_index+1]
+	};
+
+	/** A point on an edge's curve returned by the spatial queries*/
+	struct EdgePoint {
+		EdgeDescriptor edge;
+		GRuint spline_index;
+		GRfloat parameter;///<position along the spline, in [0,1]
+		Vector3f position;
+		GRfloat distance;///<distance to the query point
+	};
+
+
 	/** This class represents a graph as a set of vertices connected by edges.
 	In Graph Theory terms, it is a directed multi-graph.
 	The vertices and edges are identified by 'Descriptors' and their nature (position, shape, etc.) are stored in 'Properties'
@@ -104,6 +153,37 @@ namespace grapholon {
 
 		InternalBoostGraph internal_graph_;
 
+		/** The spatial index is built on the first query and kept up to date lazily :
+		structural changes (added/removed vertices, edges or splines) trigger a rebuild and
+		geometric changes (moved vertices, deformed edges) only a refit of the bounding boxes.
+		NOTE : the const queries may thus write to it, see prepare_spatial_queries()*/
+		mutable SegmentBVH<SpatialIndexEntry> vertex_index_;
+		mutable SegmentBVH<SpatialIndexEntry> edge_index_;
+		mutable bool spatial_index_needs_rebuild_ = true;
+		mutable bool spatial_index_needs_refit_ = false;
+
+		/** The ARAP precomputation of the edge being dragged by deform_edge()*/
+		CurveDeformationSession deformation_session_;
+		EdgeDescriptor deformation_session_edge_;
+
+		void structure_changed() {
+			spatial_index_needs_rebuild_ = true;
+			deformation_session_.reset();
+		}
+
+		void geometry_changed() {
+			spatial_index_needs_refit_ = true;
+		}
+
+		void update_spatial_index() const {
+			if (spatial_index_needs_rebuild_) {
+				rebuild_spatial_index();
+			}
+			else if (spatial_index_needs_refit_) {
+				refit_spatial_index();
+			}
+		}
+
 	public:
 
 		static VertexDescriptor null_vertex() {
@@ -113,7 +193,7 @@ namespace grapholon {
 		typedef enum { SOURCE, TARGET, MIDPOINT } COLLAPSE_OPTION;
 
 		SkeletalGraph(GRuint vertex_count = 0) :internal_graph_(vertex_count) {
-			std::cout << "created SkeletalGraph with " << vertex_count << " vertices and no edges : " << std::endl;
+			GR_LOG_INFO("created SkeletalGraph with " << vertex_count << " vertices and no edges");
 
 		}
 
@@ -147,11 +227,13 @@ namespace grapholon {
 
 		/**************************************************************************************************** Vertex stuff */
 		VertexDescriptor add_vertex(VertexProperties properties) {
+			structure_changed();
 			return boost::add_vertex(properties, internal_graph_);
 		}
 
 		EdgeVector remove_vertex(VertexDescriptor vertex) {
 			if (vertex != InternalBoostGraph::null_vertex()) {
+				structure_changed();
 				std::vector<EdgeDescriptor> removed_edges = clear_vertex(vertex);
 				boost::remove_vertex(vertex, internal_graph_);
 				return removed_edges;
@@ -163,6 +245,7 @@ namespace grapholon {
 			EdgeVector removed_edges;
 
 			if (degree(vertex)) {
+				structure_changed();
 				std::pair<InEdgeIterator, InEdgeIterator> in_edges = boost::in_edges(vertex, internal_graph_);
 				std::pair<OutEdgeIterator, OutEdgeIterator> out_edges = boost::out_edges(vertex, internal_graph_);
 
@@ -193,36 +276,52 @@ namespace grapholon {
 		}
 
 		/** When updating a vertex's position, the connected edges are deformed to match their new end.
-		By default, the deformations are "As-Rigid-As-Possible" but other deformation methods could be used (e.g. spring-mass)*/
+		By default, the deformations are "As-Rigid-As-Possible" (see PolylineDeformer) but other deformation methods could be used (e.g. spring-mass)*/
 		bool update_vertex_position(VertexDescriptor vertex, Vector3f new_position, bool maintain_shape_around_tip = true) {
+			return update_vertex_positions({ { vertex, new_position } }, maintain_shape_around_tip);
+		}
 
-			if (vertex == InternalBoostGraph::null_vertex()
-				|| vertex == VertexDescriptor()) {
-				return false;
-			}
-
-			internal_graph_[vertex].position = new_position;
+		/** Moves several vertices at once (e.g. a multi-vertex drag) and deforms all their edges in one batch (see deform_edges).
+		An edge between two moved vertices is deformed once, with both its ends moving*/
+		bool update_vertex_positions(const std::vector<std::pair<VertexDescriptor, Vector3f>>& new_positions,
+			bool maintain_shape_around_tip = true, GRuint thread_count = 0) {
 
-			std::pair<InEdgeIterator, InEdgeIterator> in_edges = boost::in_edges(vertex, internal_graph_);
-			std::pair<OutEdgeIterator, OutEdgeIterator> out_edges = boost::out_edges(vertex, internal_graph_);
+			//nothing moves if one of the vertices is invalid
+			for (auto& new_position : new_positions) {
+				if (new_position.first == InternalBoostGraph::null_vertex()
+					|| new_position.first == VertexDescriptor()) {
+					return false;
+				}
+			}
 
+			std::vector<EdgeDeformation> deformations;
+			for (auto& new_position : new_positions) {
+				VertexDescriptor vertex = new_position.first;
+				internal_graph_[vertex].position = new_position.second;
 
-			for (InEdgeIterator e_it(in_edges.first); e_it != in_edges.second; e_it++) {
+				std::pair<InEdgeIterator, InEdgeIterator> in_edges = boost::in_edges(vertex, internal_graph_);
+				std::pair<OutEdgeIterator, OutEdgeIterator> out_edges = boost::out_edges(vertex, internal_graph_);
 
-				if (!CurveDeformer::deform_curve(internal_graph_[*e_it].curve, internal_graph_[*e_it].curve.size()-1, new_position)) {
-					if (!internal_graph_[*e_it].curve.pseudo_elastic_deform(false, new_position, maintain_shape_around_tip)) {
-						return false;
-					}
+				for (InEdgeIterator e_it(in_edges.first); e_it != in_edges.second; e_it++) {
+					deformations.push_back({ *e_it, (GRuint)internal_graph_[*e_it].curve.size() - 1, new_position.second });
 				}
-			}
-			for (OutEdgeIterator e_it(out_edges.first); e_it != out_edges.second; e_it++) {
-				if (!CurveDeformer::deform_curve(internal_graph_[*e_it].curve, 0, new_position)) {
-					if (!internal_graph_[*e_it].curve.pseudo_elastic_deform(true, new_position, maintain_shape_around_tip)) {
-						return false;
-					}
+				for (OutEdgeIterator e_it(out_edges.first); e_it != out_edges.second; e_it++) {
+					deformations.push_back({ *e_it, 0, new_position.second });
 				}
 			}
+			geometry_changed();
+
+			std::vector<EdgeDeformation> failed_deformations;
+			if (deform_edges(deformations, thread_count, &failed_deformations)) {
+				return true;
+			}
 
+			//the curves that could not be deformed as a whole fall back to moving their tips one at a time
+			for (auto& deformation : failed_deformations) {
+				if (!internal_graph_[deformation.edge].curve.pseudo_elastic_deform(deformation.point_index == 0, deformation.target_position, maintain_shape_around_tip)) {
+					return false;
+				}
+			}
 			return true;
 		}
 
@@ -236,6 +335,7 @@ namespace grapholon {
 
 			//update the vertex's position
 			internal_graph_[vertex] = { new_position };
+			structure_changed();
 
 			std::pair<InEdgeIterator, InEdgeIterator> in_edges = boost::in_edges(vertex, internal_graph_);
 			DeformableSplineCurve& edge_curve = get_edge(*(in_edges.first)).curve;
@@ -429,8 +529,11 @@ namespace grapholon {
 				return { EdgeDescriptor(), false };
 			}
 			edge_spline_count_ += (GRuint)properties.curve.size();
+			structure_changed();
 
-			std::pair<EdgeDescriptor, bool> new_edge = boost::add_edge(from, to, properties, internal_graph_);
+			//the properties are moved in the graph to avoid copying the curve a second time
+			std::pair<EdgeDescriptor, bool> new_edge = boost::add_edge(from, to, internal_graph_);
+			get_edge(new_edge.first) = std::move(properties);
 
 			get_edge(new_edge.first).is_part_of_cycle = (get_vertex(from).is_part_of_cycle && get_vertex(to).is_part_of_cycle);
 
@@ -450,7 +553,7 @@ namespace grapholon {
 				)
 			});
 
-			return add_edge(from, to, properties);
+			return add_edge(from, to, std::move(properties));
 		}
 
 		/** If either vertex connected by the edge is of degree 0 after removal, they are also removed (and their descriptor is returned by this method)*/
@@ -469,7 +572,7 @@ namespace grapholon {
 			if (boost::edge(source, target, internal_graph_).second) {
 
 				edge_spline_count_ -= (GRuint)internal_graph_[edge].curve.size();
-
+				structure_changed();
 
 				bool remove_source = false;
 				bool remove_target = false;
@@ -558,11 +661,96 @@ namespace grapholon {
 
 
 
-			CurveDeformer::deform_curve(internal_graph_[edge].curve, point_index, target_position);
+			//successive calls for the same point of the same edge (e.g. while dragging it) reuse the ARAP precomputation
+			DeformableSplineCurve& curve = internal_graph_[edge].curve;
+			if (!(deformation_session_edge_ == edge && deformation_session_.matches(curve, point_index))) {
+				deformation_session_edge_ = edge;
+				if (!deformation_session_.begin(curve, point_index)) {
+					return;
+				}
+			}
+			deformation_session_.deform(curve, target_position);
+			geometry_changed();
 		}
 
+		/** Deforms many edges at once (As-Rigid-As-Possible, see PolylineDeformer). The deformations of the same edge are
+		solved together, and the edges are solved concurrently on thread_count threads (0 uses all the hardware threads).
+		The new curves are only written back once all of them were computed. If one of the curves can't be deformed,
+		false is returned and :
+		 - without failed_deformations, none of the curves is modified
+		 - with failed_deformations, the other curves are deformed and the deformations of the failed ones are added to it*/
+		bool deform_edges(const std::vector<EdgeDeformation>& deformations, GRuint thread_count = 0,
+			std::vector<EdgeDeformation>* failed_deformations = nullptr) {
+			if (!deformations.size()) {
+				return true;
+			}
+
+			//group the deformations by edge
+			std::vector<GRuint> order(deformations.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&](GRuint a, GRuint b) {
+				return std::less<const EdgeProperties*>()(&internal_graph_[deformations[a].edge], &internal_graph_[deformations[b].edge]);
+			});
+			std::vector<GRuint> group_starts;
+			for (GRuint i(0); i < order.size(); i++) {
+				if (!i || !(deformations[order[i]].edge == deformations[order[i - 1]].edge)) {
+					group_starts.push_back(i);
+				}
+			}
+			GRuint group_count = (GRuint)group_starts.size();
+			group_starts.push_back((GRuint)order.size());
+
+			std::vector<std::vector<Vector3f>> new_points(group_count);
+			std::vector<char> deformed(group_count, 0);
+			parallel_for(0, group_count, [&](GRuint group) {
+				std::vector<GRuint> control_point_indices;
+				std::vector<Vector3f> target_positions;
+				for (GRuint i(group_starts[group]); i < group_starts[group + 1]; i++) {
+					control_point_indices.push_back(deformations[order[i]].point_index);
+					target_positions.push_back(deformations[order[i]].target_position);
+				}
+				deformed[group] = PolylineDeformer::deform_curve_points(internal_graph_[deformations[order[group_starts[group]]].edge].curve,
+					control_point_indices, target_positions, new_points[group]);
+			}, thread_count);
+
+			bool all_deformed = std::find(deformed.begin(), deformed.end(), 0) == deformed.end();
+			if (!all_deformed) {
+				if (!failed_deformations) {
+					return false;
+				}
+				for (GRuint group(0); group < group_count; group++) {
+					if (!deformed[group]) {
+						for (GRuint i(group_starts[group]); i < group_starts[group + 1]; i++) {
+							failed_deformations->push_back(deformations[order[i]]);
+						}
+					}
+				}
+			}
+
+			parallel_for(0, group_count, [&](GRuint group) {
+				if (!deformed[group]) {
+					return;
+				}
+				DeformableSplineCurve& curve = internal_graph_[deformations[order[group_starts[group]]].edge].curve;
+				for (GRuint i(0); i < curve.size(); i++) {
+					curve[i].first = new_points[group][i];
+				}
+				curve.update_tangents();
+			}, thread_count);
+
+			geometry_changed();
+			return all_deformed;
+		}
+
+		/** Releases the ARAP precomputation kept by deform_edge() (e.g. when the user releases the dragged point)*/
+		void end_edge_deformation() {
+			deformation_session_.reset();
+		}
+
+		/** Commits the edge's current shape : its original shape is released and the next deformation starts from here*/
 		void fix_curve_shape(EdgeDescriptor edge) {
-			internal_graph_[edge].curve.set_original_shape();
+			internal_graph_[edge].curve.release_original_shape();
+			deformation_session_.reset();
 		}
 
 		//TODO : maybe better
@@ -1286,238 +1474,235 @@ shortest_path(source_edge_target, target_edge_target)
 			}
 		}
 
-		bool export_to_file(std::string filename, GRfloat scale = 1.0f) {
-			std::ofstream output_file(filename.c_str());
-
-			std::map<VertexDescriptor, GRuint> vertex_index_map;
+		/** Writes the graph in the text format read by import_from_file(). The floats are written with the fewest digits that read back exactly.
+		\param compress whether to compress the file (see Compression.hpp). import_from_file() detects compressed files by itself*/
+		bool export_to_file(std::string filename, GRfloat scale = 1.0f, bool compress = false) const {
+			GraphTextWriter output_file;
+			if (!output_file.open(filename, compress)) {
+				return false;
+			}
 
+			std::unordered_map<VertexDescriptor, GRuint> vertex_index_map;
+			vertex_index_map.reserve(vertex_count());
 
-			if (output_file.is_open()) {
+			output_file.write("<scale>");
+			output_file.write_float(scale);
+			output_file.write("</scale>\n");
 
-				output_file << "<scale>" << scale << "</scale>" << std::endl;
+			GRuint iteration_count(0);
+			std::pair<VertexIterator, VertexIterator> vp;
 
-				GRuint iteration_count(0);
-				std::pair<VertexIterator, VertexIterator> vp;
+			output_file.write("<vertices>\n");
 
-				output_file << "<vertices>\n";
+			for (vp = boost::vertices(internal_graph_); vp.first != vp.second; ++vp.first) {
+				const VertexProperties& props = internal_graph_[*vp.first];
+				output_file.write("<vertex>\n<pos>");
+				output_file.write_point(props.position);
+				output_file.write("</pos>\n<radius>");
+				output_file.write_float(props.radius);
+				output_file.write(props.is_part_of_cycle ? "</radius>\n<cycle>1</cycle>\n</vertex>\n" : "</radius>\n<cycle>0</cycle>\n</vertex>\n");
+
+				vertex_index_map.insert({ *vp.first, iteration_count });
+				iteration_count++;
+			}
+			output_file.write("</vertices>\n");
 
-				for (vp = boost::vertices(internal_graph_); vp.first != vp.second; ++vp.first) {
-					VertexDescriptor v = *vp.first;
-					VertexProperties props = internal_graph_[v];
-					output_file << "<vertex>\n";
-					output_file << "<pos>" << props.position.to_compact_string() << "</pos>\n";
-					output_file << "<radius>" << props.radius << "</radius>\n";
-					output_file << "<cycle>" << props.is_part_of_cycle << "</cycle>\n";
-					output_file << "</vertex>\n";
+			output_file.write("<edges>\n");
+			std::pair<EdgeIterator, EdgeIterator> ep;
+			for (ep = boost::edges(internal_graph_); ep.first != ep.second; ++ep.first) {
+				const EdgeProperties& props = internal_graph_[*ep.first];
 
-					vertex_index_map.insert({v, iteration_count});
-					iteration_count++;
+				auto source_it = vertex_index_map.find(boost::source(*ep.first, internal_graph_));
+				auto target_it = vertex_index_map.find(boost::target(*ep.first, internal_graph_));
+				if (source_it == vertex_index_map.end() || target_it == vertex_index_map.end()) {
+					GR_LOG_ERROR("ERROR : invalid edge found when trying to export graph");
+					output_file.close();
+					return false;
 				}
-				output_file << "</vertices>\n";
 
+				output_file.write("<edge>\n<source>");
+				output_file.write_uint(source_it->second);
+				output_file.write("</source>\n<target>");
+				output_file.write_uint(target_it->second);
+				output_file.write(props.is_part_of_cycle ? "</target>\n<cycle>1</cycle>\n<curve>\n" : "</target>\n<cycle>0</cycle>\n<curve>\n");
 
-				iteration_count = 0;
+				for (auto& point_tangent : props.curve) {
+					output_file.write_point(point_tangent.first);
+					output_file.write("\n");
+				}
 
-				output_file << "<edges>\n";
-				std::pair<EdgeIterator, EdgeIterator> ep ;
-				for (ep = boost::edges(internal_graph_); ep.first != ep.second; ++ep.first) {
-					output_file << "<edge>\n";
+				output_file.write("</curve>\n</edge>\n");
+			}
+			output_file.write("</edges>\n");
 
-					EdgeDescriptor e = *ep.first;
-					EdgeProperties props = internal_graph_[e];
-					std::map<VertexDescriptor, GRuint>::iterator index_it = vertex_index_map.find(boost::source(e, internal_graph_));
-					if (index_it == vertex_index_map.end()) {
-						std::cerr << "ERROR : invalid edge found when trying to export graph" << std::endl;
-						output_file.close();
-						return false;
-					}
-					output_file << "<source>" << index_it->second <<"</source>\n";
+			return output_file.close();
+		}
 
-					index_it = vertex_index_map.find(boost::target(e, internal_graph_));
-					if (index_it == vertex_index_map.end()) {
-						std::cerr << "ERROR : invalid edge found when trying to export graph" << std::endl;
-						output_file.close();
-						return false;
-					}
-					output_file << "<target>" << index_it->second << "</target>\n";
 
-					output_file << "<cycle>" << props.is_part_of_cycle << "</cycle>\n";
+		/** NOTE : this allocates a new Graph. It should be deleted when done with it
+		\param thread_count if different from 1, the edges of large files are parsed on that many threads (0 uses all the hardware threads)*/
+		static void import_from_file(std::string filename, SkeletalGraph* graph, GRfloat& scale, GRuint thread_count = 1) {
+			scale = 1.0f;
 
-					output_file << "<curve>\n";
-					output_file << props.curve.to_compact_string();
+			if (graph == nullptr) {
+				throw std::runtime_error("ERROR - Cannot set nullptr SkeletalGraph");
+			}
 
-					output_file << "</curve>\n";
+			MappedFile input_file;
+			if (!input_file.open(filename)) {
+				throw std::runtime_error("ERROR - Could not open specified file. No SkeletalGraph was imported");
+			}
 
-					output_file << "</edge>\n";
+			//compressed files are decompressed in memory first
+			std::vector<char> decompressed;
+			const char* data = input_file.data();
+			size_t size = input_file.size();
+			if (is_lz_stream(data, size)) {
+				if (!lz_decompress_stream(data, size, decompressed)) {
+					throw std::runtime_error("ERROR - Could not decompress specified file. No SkeletalGraph was imported");
 				}
-				output_file << "</edges>\n";
+				data = decompressed.data();
+				size = decompressed.size();
+			}
 
+			GraphTables tables;
+			GraphTextParser parser(data, size);
+			if (thread_count == 1) {
+				parser.parse(tables);
+			}
+			else {
+				parser.parse_parallel(tables, thread_count);
+			}
+			graph->build_from_tables(tables);
 
+			scale = tables.scale;
+		}
 
-				output_file.close();
-				return true;
+		/** Writes the graph in the binary format described in GraphFile.hpp*/
+		bool export_to_binary_file(std::string filename, GRfloat scale = 1.0f) const {
+			std::unordered_map<VertexDescriptor, GRuint> indices = vertex_indices();
+
+			std::vector<GraphFileVertex> vertices(vertex_count());
+			for (auto& descriptor_and_index : indices) {
+				const VertexProperties& props = internal_graph_[descriptor_and_index.first];
+				GraphFileVertex& vertex = vertices[descriptor_and_index.second];
+				vertex.position[0] = props.position.X();
+				vertex.position[1] = props.position.Y();
+				vertex.position[2] = props.position.Z();
+				vertex.radius = props.radius;
+				vertex.flags = props.is_part_of_cycle ? GRAPH_FILE_CYCLE_FLAG : 0;
 			}
 
-			return false;
-		}
+			std::vector<GraphFileEdge> edges;
+			edges.reserve(edge_count());
+			std::vector<GRfloat> points;
+			points.reserve(3 * edge_spline_count_);
 
+			std::pair<EdgeIterator, EdgeIterator> ep;
+			for (ep = boost::edges(internal_graph_); ep.first != ep.second; ++ep.first) {
+				const EdgeProperties& props = internal_graph_[*ep.first];
 
-		/** NOTE : this allocates a new Graph. It should be deleted when done with it*/
-		static void import_from_file(std::string filename, SkeletalGraph* graph, GRfloat& scale) {
-			scale = 1.0f;
+				GraphFileEdge edge;
+				edge.source = indices.find(boost::source(*ep.first, internal_graph_))->second;
+				edge.target = indices.find(boost::target(*ep.first, internal_graph_))->second;
+				edge.flags = props.is_part_of_cycle ? GRAPH_FILE_CYCLE_FLAG : 0;
+				edge.point_count = (std::uint32_t)props.curve.size();
+				edge.first_point = points.size() / 3;
+				edges.push_back(edge);
 
+				for (auto& point_tangent : props.curve) {
+					points.push_back(point_tangent.first.X());
+					points.push_back(point_tangent.first.Y());
+					points.push_back(point_tangent.first.Z());
+				}
+			}
+
+			return write_graph_file(filename, scale, vertices, edges, points);
+		}
+
+		/** Reads a file written by export_to_binary_file(). The file is memory-mapped and the graph is built straight from its tables.
+		Throws a std::runtime_error if the file is invalid*/
+		static void import_from_binary_file(std::string filename, SkeletalGraph* graph, GRfloat& scale) {
 			if (graph == nullptr) {
 				throw std::runtime_error("ERROR - Cannot set nullptr SkeletalGraph");
 			}
 
-			std::ifstream input_file(filename);
-			if (! input_file.is_open()) {
-				throw std::runtime_error("ERROR - Could not open specified file. No SkeletalGraph was imported");
-			}
+			GraphFileView file;
+			file.open(filename);
+			graph->build_from_file_view(file);
 
-			VertexVector vertices;
+			scale = file.header().scale;
+		}
 
-			std::string line;
-			bool reading_vertices(false);
-			bool reading_edges(false);
-			bool reading_vertex(false);
-			bool reading_edge(false);
-			bool reading_curve(false);
+		/** Adds the vertices and edges stored in a mapped binary graph file*/
+		void build_from_file_view(const GraphFileView& file) {
+			const GraphFileHeader& header = file.header();
+			build_from_tables(file.vertices(), header.vertex_count, file.edges(), header.edge_count, file.points(), header.point_count);
+		}
 
-			VertexProperties v_props;
-			EdgeProperties e_props;
-			GRuint e_source_index = 0;
-			GRuint e_target_index = 0;
-			DiscreteCurve e_curve;
+		/** Adds the vertices and edges read from a text graph file (see build_from_tables() with text_file)*/
+		void build_from_tables(const GraphTables& tables) {
+			build_from_tables(tables.vertices.data(), (GRuint)tables.vertices.size(),
+				tables.edges.data(), (GRuint)tables.edges.size(),
+				tables.points.data(), tables.points.size() / 3, true);
+		}
 
+		/** Adds the vertices and edges of a graph file's tables (see GraphFile.hpp).
+		With text_file, the text importer's rules apply : edges with less than two curve points are added with the curve
+		SplineCurve builds from them, and the edges' cycle flags are computed by add_edge() instead of read from the file.
+		Throws a std::runtime_error if an edge is invalid*/
+		void build_from_tables(const GraphFileVertex* file_vertices, GRuint vertex_count,
+			const GraphFileEdge* file_edges, GRuint edge_count,
+			const GRfloat* file_points, std::uint64_t point_count, bool text_file = false) {
 
-			while (std::getline(input_file, line)) {
-				if (line.substr(0, 7) == "<scale>") {
-					sscanf_s(line.c_str(), "<scale>%f</scale>", &scale);
-				}
-				else if (line == "<vertices>") {
-					reading_vertices = true;
+			//check the edges first so that an invalid file leaves the graph untouched
+			for (GRuint i(0); i < edge_count; i++) {
+				const GraphFileEdge& edge = file_edges[i];
+				if (edge.source >= vertex_count
+					|| edge.target >= vertex_count
+					|| (!text_file && edge.point_count < 2)
+					|| edge.first_point > point_count
+					|| edge.point_count > point_count - edge.first_point) {
+					throw std::runtime_error("ERROR - Invalid edge " + std::to_string(i) + " in graph file");
 				}
-				else if (line == "</vertices>") {
-					reading_vertices = false;
-				}
-				else if (reading_vertices) {
-
-					if (line == "<vertex>") {
-						reading_vertex = true;
-						v_props = VertexProperties();
-					}
-					else if (line == "</vertex>") {
-						reading_vertex = false;
-						vertices.push_back(graph->add_vertex(v_props));
-					}
-					else if (reading_vertex) {
-						if (line.substr(0, 5) == "<pos>") {
-							GRfloat x(0.f), y(0.f), z(0.f);
-							if (sscanf_s(line.c_str(), "<pos>%f %f %f</pos>", &x, &y, &z) == 3) {
-								v_props.position = Vector3f(x, y, z);
-							}
-							else {
-								std::cerr << "could not read position from line : " << line << std::endl;
-								v_props.position = Vector3f(0.f);
-							}
-
-						}else if (line.substr(0, 8) == "<radius>") {
-							GRfloat radius = DEFAULT_VERTEX_RADIUS;
-							if (sscanf_s(line.c_str(), "<radius>%f</radius>", &radius) == 1) {
-								v_props.radius = radius;
-								if (radius > MAX_ALLOWED_VERTEX_RADIUS) {
-									radius = 1.f;
-								}
-							}
-							else {
-								std::cerr << "could not read radius from line : " << line << std::endl;
-								v_props.radius = DEFAULT_VERTEX_RADIUS;
-							}
+			}
 
-						}
-						else if (line.substr(0, 7) == "<cycle>") {
-							GRuint cycle = false;
-							if (sscanf_s(line.c_str(), "<cycle>%u</cycle>", &cycle) == 1) {
-								v_props.is_part_of_cycle = cycle;
-							}
-							else {
-								std::cerr << "could not read if in cycle from line : " << line << std::endl;
-								v_props.is_part_of_cycle = false;
-							}
-						}
+			VertexVector vertices;
+			vertices.reserve(vertex_count);
+			for (GRuint i(0); i < vertex_count; i++) {
+				const GraphFileVertex& vertex = file_vertices[i];
+				VertexProperties props;
+				props.position = Vector3f(vertex.position[0], vertex.position[1], vertex.position[2]);
+				props.radius = vertex.radius;
+				props.is_part_of_cycle = (vertex.flags & GRAPH_FILE_CYCLE_FLAG) != 0;
+				vertices.push_back(add_vertex(props));
+			}
+
+			for (GRuint i(0); i < edge_count; i++) {
+				const GraphFileEdge& edge = file_edges[i];
+
+				EdgeProperties props;
+				const GRfloat* point = file_points + 3 * edge.first_point;
+				if (edge.point_count < 2) {
+					std::vector<Vector3f> points;
+					for (GRuint j(0); j < edge.point_count; j++, point += 3) {
+						points.push_back(Vector3f(point[0], point[1], point[2]));
 					}
-
+					props.curve = DeformableSplineCurve(points);
 				}
-				else if (line == "<edges>") {
-					reading_edges = true;
-					if (!vertices.size()) {
-						break;
+				else {
+					props.curve.clear();
+					props.curve.reserve(edge.point_count);
+					for (GRuint j(0); j < edge.point_count; j++, point += 3) {
+						props.curve.push_back(PointTangent(Vector3f(point[0], point[1], point[2]), Vector3f(0.f)));
 					}
+					props.curve.update_tangents();
 				}
-				else if (line == "</edges>") {
-					reading_edges = false;
-				}
-				else if (reading_edges) {
-					if (line == "<edge>") {
-						reading_edge = true;
-						e_props = EdgeProperties();
-						e_source_index = 0;
-						e_target_index = 0;
-						e_curve = DiscreteCurve();
-					}
-					else if (line == "</edge>") {
-						reading_edge = false;
-						if (e_source_index < vertices.size() && e_target_index < vertices.size()) {
-							graph->add_edge(vertices[e_source_index], vertices[e_target_index], e_props);
-						}
-						else {
-							std::cerr << " ERROR - could not add edge with invalid vertex indices : " << e_source_index << ", " << e_target_index << std::endl;
-						}
-					}
-					else if (reading_edge) {
-						if (line == "<curve>") {
-							reading_curve = true;
-						}
-						else if (line == "</curve>") {
-							reading_curve = false;
-							try {
-								e_props.curve = DeformableSplineCurve(e_curve);
-							}
-							catch (std::runtime_error e) {
-								std::cerr << e.what() << std::endl;
-							}
-						}
-						else if (reading_curve) {
-							GRfloat x(0.f), y(0.f), z(0.f);
-							if (sscanf_s(line.c_str(), "%f %f %f", &x, &y, &z) == 3) {
-								e_curve.push_back(Vector3f(x, y, z));
-							}
-							else {
-								std::cerr << "could not curve point from line : " << line << std::endl;
-							}
-						}
-						else if (line.substr(0, 8) == "<source>") {							
-							if (sscanf_s(line.c_str(), "<source>%u</source>", &e_source_index) != 1) {
-								std::cerr << "could not read source from line : " << line << std::endl;
-							}
-						}
-						else if (line.substr(0, 8) == "<target>") {
-							if (sscanf_s(line.c_str(), "<target>%u</target>", &e_target_index) != 1) {
-								std::cerr << "could not read target from line : " << line << std::endl;
-								std::cerr << " read : " << sscanf_s(line.c_str(), "<target>%u</target>", &e_target_index) << std::endl;
-							}
-						}
-						else if (line.substr(0, 7) == "<cycle>") {
-							GRuint cycle = 0;
-							if (sscanf_s(line.c_str(), "<cycle>%u</cycle>", &cycle) == 1) {
-								e_props.is_part_of_cycle = cycle;
-							}else{
-								std::cerr << "could not read cycle from line : " << line << std::endl;
-							}
-						}
-						
-					}
+
+				//add_edge() computes the edge's cycle flag from its vertices, so the stored one is set afterwards
+				EdgeDescriptor new_edge = add_edge(vertices[edge.source], vertices[edge.target], std::move(props)).first;
+				if (!text_file) {
+					get_edge(new_edge).is_part_of_cycle = (edge.flags & GRAPH_FILE_CYCLE_FLAG) != 0;
 				}
 			}
 		}
@@ -1580,7 +1765,7 @@ shortest_path(source_edge_target, target_edge_target)
 			*/
 			
 			if (path_one.front() != path_two.front()) {
-				std::cerr << "ERROR - both paths don't have the same root !!" << std::endl;
+				GR_LOG_ERROR("ERROR - both paths don't have the same root !!");
 
 			}
 
@@ -1629,7 +1814,7 @@ shortest_path(source_edge_target, target_edge_target)
 					get_edge(out_edge.first).is_part_of_cycle = true;
 
 				}else{
-					std::cerr << "ERROR - edge from " << get_vertex(next_vertex).position.to_string() << " to " << get_vertex(last_vertex).position.to_string() << " has somehow disappeared" << std::endl;
+					GR_LOG_ERROR("ERROR - edge from " << get_vertex(next_vertex).position.to_string() << " to " << get_vertex(last_vertex).position.to_string() << " has somehow disappeared");
 					exit(EXIT_FAILURE);
 				}
 				iteration_count++;
@@ -1654,7 +1839,7 @@ shortest_path(source_edge_target, target_edge_target)
 					get_edge(out_edge.first).is_part_of_cycle = true;
 				}
 				else {
-					std::cerr << "ERROR - edge from " << get_vertex(next_vertex).position.to_string() << " to " << get_vertex(last_vertex).position.to_string() << " has somehow disappeared" << std::endl;
+					GR_LOG_ERROR("ERROR - edge from " << get_vertex(next_vertex).position.to_string() << " to " << get_vertex(last_vertex).position.to_string() << " has somehow disappeared");
 					exit(EXIT_FAILURE);
 				}
 				iteration_count++;
@@ -1817,6 +2002,374 @@ shortest_path(source_edge_target, target_edge_target)
 
 
 
+		/** Assigns a contiguous index to each vertex, following the vertex iteration order.
+		Since the vertices are stored in a list, this is what allows O(1) per-vertex lookups in flat arrays*/
+		std::unordered_map<VertexDescriptor, GRuint> vertex_indices() const {
+			std::unordered_map<VertexDescriptor, GRuint> indices;
+			indices.reserve(vertex_count());
+
+			GRuint index(0);
+			std::pair<VertexIterator, VertexIterator> vp;
+			for (vp = boost::vertices(internal_graph_); vp.first != vp.second; ++vp.first) {
+				indices.insert({ *vp.first, index++ });
+			}
+			return indices;
+		}
+
+
+		/** Returns a fundamental cycle basis of the graph, i.e. one cycle for each edge that is not part of a (BFS) spanning forest.
+		Each cycle is the list of its edges in order along the cycle, starting with the non-tree edge that closes it.
+		Unlike find_cycles(), this runs in O(V+E) plus the size of the output : the spanning forest is built once and each
+		cycle is found by climbing from both ends of its closing edge up to their lowest common ancestor, using the depth
+		of the vertices in the forest so that each step of the climb adds an edge to the cycle.
+		NOTE : edge directions are ignored, so consecutive edges of a cycle do not necessarily point the same way*/
+		CycleBasis fundamental_cycle_basis() const {
+			CycleBasis cycles;
+
+			const GRuint n = vertex_count();
+			const GRuint NO_PARENT = (GRuint)-1;
+
+			std::unordered_map<VertexDescriptor, GRuint> indices = vertex_indices();
+			std::vector<VertexDescriptor> descriptors(n);
+			for (auto& descriptor_and_index : indices) {
+				descriptors[descriptor_and_index.second] = descriptor_and_index.first;
+			}
+
+			std::vector<GRuint> parent(n, NO_PARENT);
+			std::vector<EdgeDescriptor> parent_edge(n);
+			std::vector<GRuint> depth(n, 0);
+			std::vector<bool> visited(n, false);
+
+			//first build the spanning forest with one BFS per connected component
+			std::vector<GRuint> vertex_queue;
+			vertex_queue.reserve(n);
+			for (GRuint root(0); root < n; root++) {
+				if (visited[root]) {
+					continue;
+				}
+				visited[root] = true;
+				vertex_queue.clear();
+				vertex_queue.push_back(root);
+
+				for (size_t head(0); head < vertex_queue.size(); head++) {
+					GRuint current = vertex_queue[head];
+
+					auto visit = [&](VertexDescriptor neighbor, EdgeDescriptor edge) {
+						GRuint neighbor_index = indices.find(neighbor)->second;
+						if (!visited[neighbor_index]) {
+							visited[neighbor_index] = true;
+							parent[neighbor_index] = current;
+							parent_edge[neighbor_index] = edge;
+							depth[neighbor_index] = depth[current] + 1;
+							vertex_queue.push_back(neighbor_index);
+						}
+					};
+
+					std::pair<InEdgeIterator, InEdgeIterator> in_ep;
+					for (in_ep = boost::in_edges(descriptors[current], internal_graph_); in_ep.first != in_ep.second; ++in_ep.first) {
+						visit(boost::source(*in_ep.first, internal_graph_), *in_ep.first);
+					}
+					std::pair<OutEdgeIterator, OutEdgeIterator> out_ep;
+					for (out_ep = boost::out_edges(descriptors[current], internal_graph_); out_ep.first != out_ep.second; ++out_ep.first) {
+						visit(boost::target(*out_ep.first, internal_graph_), *out_ep.first);
+					}
+				}
+			}
+
+			//then each edge that is not in the forest closes exactly one cycle
+			std::pair<EdgeIterator, EdgeIterator> ep;
+			for (ep = boost::edges(internal_graph_); ep.first != ep.second; ++ep.first) {
+				EdgeDescriptor edge = *ep.first;
+				GRuint source = indices.find(boost::source(edge, internal_graph_))->second;
+				GRuint target = indices.find(boost::target(edge, internal_graph_))->second;
+
+				//the edge comparison is needed to handle parallel edges
+				if ((parent[target] == source && parent_edge[target] == edge)
+					|| (parent[source] == target && parent_edge[source] == edge)) {
+					continue;
+				}
+
+				//the cycle goes from source to target through the edge, then up from target to the common ancestor
+				//and finally down from the common ancestor to source
+				EdgeVector cycle = { edge };
+				EdgeVector path_from_source;
+				GRuint from_target = target;
+				GRuint from_source = source;
+
+				while (depth[from_target] > depth[from_source]) {
+					cycle.push_back(parent_edge[from_target]);
+					from_target = parent[from_target];
+				}
+				while (depth[from_source] > depth[from_target]) {
+					path_from_source.push_back(parent_edge[from_source]);
+					from_source = parent[from_source];
+				}
+				while (from_target != from_source) {
+					cycle.push_back(parent_edge[from_target]);
+					from_target = parent[from_target];
+					path_from_source.push_back(parent_edge[from_source]);
+					from_source = parent[from_source];
+				}
+				cycle.insert(cycle.end(), path_from_source.rbegin(), path_from_source.rend());
+
+				cycles.push_back(cycle);
+			}
+
+			return cycles;
+		}
+
+
+
+
+		/** Applies a set of simplification rules in a single pass and rebuilds the graph once at the end.
+		The rules are applied in this order :
+		 - removal of the vertices of the given degrees (with their edges)
+		 - collapse of the short edges (by length or by spline count) at their midpoints
+		 - removal of the degree-2 vertices and merging of their edges
+		This is equivalent to calling remove_vertices_of_degree(), collapse_edges_shorter_than(), collapse_edges_with_less_than_n_splines()
+		and remove_vertices_of_degree_2_and_merge_edges() one after the other, except that the graph is flattened into arrays first,
+		the edges' curves are moved around instead of being copied and each condition is checked when its vertex or edge comes up in the worklist.
+		IMPORTANT NOTE : since the graph is rebuilt, all VertexDescriptors and EdgeDescriptors are invalidated*/
+		SimplificationResult simplify(const SimplificationRules& rules) {
+			SimplificationResult result;
+
+			struct WorkEdge {
+				GRuint source;
+				GRuint target;
+				bool alive;
+				bool modified;///<whether the edge was reattached or merged (its cycle status must be re-evaluated)
+			};
+
+			//flatten the graph
+			std::unordered_map<VertexDescriptor, GRuint> indices = vertex_indices();
+			const GRuint n = vertex_count();
+
+			std::vector<VertexProperties> vertex_props(n);
+			std::vector<bool> vertex_alive(n, true);
+			std::vector<GRuint> vertex_degree(n, 0);
+			std::vector<std::vector<GRuint>> incident_edges(n);
+
+			for (auto& descriptor_and_index : indices) {
+				vertex_props[descriptor_and_index.second] = get_vertex(descriptor_and_index.first);
+			}
+
+			std::vector<WorkEdge> work_edges;
+			std::vector<EdgeProperties> edge_props;
+			work_edges.reserve(edge_count());
+			edge_props.reserve(edge_count());
+
+			std::pair<EdgeIterator, EdgeIterator> ep;
+			for (ep = boost::edges(internal_graph_); ep.first != ep.second; ++ep.first) {
+				GRuint source = indices.find(boost::source(*ep.first, internal_graph_))->second;
+				GRuint target = indices.find(boost::target(*ep.first, internal_graph_))->second;
+				GRuint edge_index = (GRuint)work_edges.size();
+
+				work_edges.push_back({ source, target, true, false });
+				edge_props.push_back(std::move(internal_graph_[*ep.first]));
+
+				incident_edges[source].push_back(edge_index);
+				vertex_degree[source]++;
+				incident_edges[target].push_back(edge_index);
+				vertex_degree[target]++;
+			}
+
+			//NOTE : incident edge lists are never cleaned up, so the dead edges and the edges
+			//that were reattached elsewhere are skipped when iterating over them
+			auto is_incident = [&](GRuint edge_index, GRuint vertex) {
+				return work_edges[edge_index].alive
+					&& (work_edges[edge_index].source == vertex || work_edges[edge_index].target == vertex);
+			};
+
+			auto kill_edge = [&](GRuint edge_index) {
+				work_edges[edge_index].alive = false;
+				vertex_degree[work_edges[edge_index].source]--;
+				vertex_degree[work_edges[edge_index].target]--;
+			};
+
+			//update the end points of a vertex's curves after it moved
+			auto snap_curves_to_vertex = [&](GRuint vertex) {
+				Vector3f position = vertex_props[vertex].position;
+				for (auto edge_index : incident_edges[vertex]) {
+					if (!is_incident(edge_index, vertex)) {
+						continue;
+					}
+					DeformableSplineCurve& curve = edge_props[edge_index].curve;
+					if (work_edges[edge_index].source == vertex) {
+						curve.front() = PointTangent(position, (curve[1].first - position).normalize());
+					}
+					if (work_edges[edge_index].target == vertex) {
+						curve.back() = PointTangent(position, (position - curve.before_back().first).normalize());
+					}
+				}
+			};
+
+			//first rule : removal of the vertices of some degrees
+			if (rules.degrees_to_remove.size()) {
+				for (GRuint vertex(0); vertex < n; vertex++) {
+					if (std::find(rules.degrees_to_remove.begin(), rules.degrees_to_remove.end(), vertex_degree[vertex]) != rules.degrees_to_remove.end()) {
+						for (auto edge_index : incident_edges[vertex]) {
+							if (work_edges[edge_index].alive) {
+								kill_edge(edge_index);
+							}
+						}
+						vertex_alive[vertex] = false;
+						result.removed_vertex_count++;
+					}
+				}
+			}
+
+			//second rule : collapse of the short edges
+			if (rules.min_edge_length > 0.f || rules.min_edge_spline_count > 0) {
+				for (GRuint edge_index(0); edge_index < (GRuint)work_edges.size(); edge_index++) {
+					GRuint to_keep = work_edges[edge_index].source;
+					GRuint to_remove = work_edges[edge_index].target;
+
+					if (!work_edges[edge_index].alive
+						|| to_keep == to_remove
+						|| vertex_degree[to_keep] == 1
+						|| vertex_degree[to_remove] == 1) {
+						continue;
+					}
+
+					const DeformableSplineCurve& curve = edge_props[edge_index].curve;
+					if (!(curve.size() < rules.min_edge_spline_count
+						|| curve.length() < rules.min_edge_length)) {
+						continue;
+					}
+
+					kill_edge(edge_index);
+
+					//reattach the removed vertex' edges to the kept one
+					for (auto other_edge_index : incident_edges[to_remove]) {
+						if (!is_incident(other_edge_index, to_remove)) {
+							continue;
+						}
+						WorkEdge& other_edge = work_edges[other_edge_index];
+
+						//like collapse_edge(), parallel edges between the two vertices are dropped
+						if (other_edge.source == to_keep || other_edge.target == to_keep) {
+							kill_edge(other_edge_index);
+							continue;
+						}
+						if (other_edge.source == to_remove) {
+							other_edge.source = to_keep;
+							vertex_degree[to_keep]++;
+						}
+						if (other_edge.target == to_remove) {
+							other_edge.target = to_keep;
+							vertex_degree[to_keep]++;
+						}
+						other_edge.modified = true;
+						incident_edges[to_keep].push_back(other_edge_index);
+					}
+
+					vertex_props[to_keep].position = (vertex_props[to_keep].position + vertex_props[to_remove].position)*0.5f;
+					snap_curves_to_vertex(to_keep);
+
+					vertex_alive[to_remove] = false;
+					vertex_degree[to_remove] = 0;
+					result.collapsed_edge_count++;
+				}
+			}
+
+			//third rule : removal of the degree-2 vertices
+			if (rules.merge_degree_2_vertices) {
+				for (GRuint vertex(0); vertex < n; vertex++) {
+					if (!vertex_alive[vertex] || vertex_degree[vertex] != 2) {
+						continue;
+					}
+
+					std::vector<GRuint> edges_to_merge;
+					for (auto edge_index : incident_edges[vertex]) {
+						if (is_incident(edge_index, vertex)
+							&& std::find(edges_to_merge.begin(), edges_to_merge.end(), edge_index) == edges_to_merge.end()) {
+							edges_to_merge.push_back(edge_index);
+						}
+					}
+
+					//a single loop edge has nothing to be merged with
+					if (edges_to_merge.size() != 2) {
+						continue;
+					}
+
+					//the first edge is the one going into the vertex, if any
+					if (work_edges[edges_to_merge[0]].target != vertex) {
+						std::swap(edges_to_merge[0], edges_to_merge[1]);
+					}
+					WorkEdge& first_edge = work_edges[edges_to_merge[0]];
+					WorkEdge& second_edge = work_edges[edges_to_merge[1]];
+					DeformableSplineCurve& first_curve = edge_props[edges_to_merge[0]].curve;
+					DeformableSplineCurve& second_curve = edge_props[edges_to_merge[1]].curve;
+
+					//orient both curves so that they go through the vertex
+					auto reverse_curve = [](DeformableSplineCurve& curve) {
+						std::reverse(curve.begin(), curve.end());
+						for (auto& point_tangent : curve) {
+							point_tangent.second *= -1.f;
+						}
+					};
+
+					GRuint new_source = first_edge.source;
+					if (first_edge.target != vertex) {
+						reverse_curve(first_curve);
+						new_source = first_edge.target;
+					}
+					GRuint new_target = second_edge.target;
+					if (second_edge.source != vertex) {
+						reverse_curve(second_curve);
+						new_target = second_edge.source;
+					}
+
+					//the second curve's first point is the removed vertex, which is already the first curve's back
+					first_curve.back().second = (second_curve[1].first - first_curve.back().first).normalize();
+					first_curve.reserve(first_curve.size() + second_curve.size() - 1);
+					first_curve.insert(first_curve.end(), second_curve.begin() + 1, second_curve.end());
+					first_curve.release_original_shape();
+
+					kill_edge(edges_to_merge[1]);
+					vertex_degree[vertex]--;
+					vertex_degree[new_target]++;
+
+					first_edge.source = new_source;
+					first_edge.target = new_target;
+					first_edge.modified = true;
+					incident_edges[new_target].push_back(edges_to_merge[0]);
+
+					vertex_alive[vertex] = false;
+					vertex_degree[vertex] = 0;
+					result.merged_vertex_count++;
+				}
+			}
+
+			//and finally rebuild the graph
+			internal_graph_.clear();
+			structure_changed();
+			edge_spline_count_ = 0;
+
+			std::vector<VertexDescriptor> new_vertices(n, null_vertex());
+			for (GRuint vertex(0); vertex < n; vertex++) {
+				if (vertex_alive[vertex]) {
+					new_vertices[vertex] = boost::add_vertex(vertex_props[vertex], internal_graph_);
+				}
+			}
+
+			for (GRuint edge_index(0); edge_index < (GRuint)work_edges.size(); edge_index++) {
+				const WorkEdge& edge = work_edges[edge_index];
+				if (!edge.alive) {
+					continue;
+				}
+				EdgeDescriptor new_edge = boost::add_edge(new_vertices[edge.source], new_vertices[edge.target], internal_graph_).first;
+				internal_graph_[new_edge] = std::move(edge_props[edge_index]);
+
+				if (edge.modified) {
+					internal_graph_[new_edge].is_part_of_cycle = vertex_props[edge.source].is_part_of_cycle && vertex_props[edge.target].is_part_of_cycle;
+				}
+				edge_spline_count_ += (GRuint)internal_graph_[new_edge].curve.size();
+			}
+
+			return result;
+		}
+
 
 		GRuint collapse_edges_shorter_than(GRfloat min_length) {
 			std::vector<EdgeDescriptor> edges_to_collapse;
@@ -1847,7 +2400,7 @@ shortest_path(source_edge_target, target_edge_target)
 					}
 				}
 				catch (std::invalid_argument e) {
-					std::cerr << e.what() << std::endl;
+					GR_LOG_ERROR(e.what());
 				}
 			}
 
@@ -1915,146 +2468,86 @@ shortest_path(source_edge_target, target_edge_target)
 		}
 
 		//returns the merged edge and the pair of removed edges
+		//NOTE : the first curve is moved out of the graph and only the second one's points are copied
 		std::pair<EdgeDescriptor, EdgePair> remove_degree_2_vertex_and_merge_edges(VertexDescriptor vertex_to_remove) {
 			if (degree(vertex_to_remove) != 2) {
 				throw std::invalid_argument(" Trying to merge edges of non degree-2 vertex");
 			}
 
-			VertexDescriptor new_source;
-			VertexDescriptor new_target;
-			EdgeProperties new_curve;
-
-			//first we gather the two edges's curves
-
-					//those should vary in size between 0 and 2 only
-			std::vector<VertexDescriptor> sources;
-			std::vector<VertexDescriptor> targets;
-
-			//same
-			std::vector<EdgeProperties> in_curves;
-			std::vector<EdgeProperties> out_curves;
+			//first we gather the two edges (in-edges first)
+			EdgeVector edges;
+			edges.reserve(2);
 
 			std::pair<InEdgeIterator, InEdgeIterator> in_edges = boost::in_edges(vertex_to_remove, internal_graph_);
 			std::pair<OutEdgeIterator, OutEdgeIterator> out_edges = boost::out_edges(vertex_to_remove, internal_graph_);
 
 			for (InEdgeIterator e_it(in_edges.first); e_it != in_edges.second; e_it++) {
-				in_curves.push_back(get_edge(*e_it));
-				sources.push_back(boost::source(*e_it, internal_graph_));
+				edges.push_back(*e_it);
 			}
 			for (OutEdgeIterator e_it(out_edges.first); e_it != out_edges.second; e_it++) {
-				out_curves.push_back(get_edge(*e_it));
-				targets.push_back(boost::target(*e_it, internal_graph_));
+				edges.push_back(*e_it);
 			}
 
-			//and merge them together in a way that depends on their direction (->*<- ,  <-*->, ->*-> or <-*<-)
-
-			//in case the directions are the same we add the out curve to the incident curve
-			if (in_curves.size() == 1 && out_curves.size() == 1) {
-
-				//copy the in curve
-				EdgeProperties new_prop = in_curves[0];
-
-				//update the tangent (we don't take the first PointTangent since it's the same as 
-				//the last of the incident curve. i.e. the removed vertex' position)
-				new_prop.curve.back().second = (out_curves[0].curve[1].first - new_prop.curve.back().first).normalize();
-
-				//add the out curve (same comment)
-				for (GRuint i(1); i < out_curves[0].curve.size(); i++) {
-					new_prop.curve.push_back(out_curves[0].curve[i]);
-				}
-
-				//and add the new curve
-				new_curve = new_prop;
-
-				//and add the new source and target
-				new_source = sources[0];
-				new_target = targets[0];
-
+			//a self-loop has nothing to be merged with
+			if (edges.size() != 2 || edges[0] == edges[1]) {
+				throw std::runtime_error("Could not create new edge to replace vertex of degree 2");
 			}
-			//and if the directions are not the same we further check if it's two out or two in edges
-			else if (in_curves.size() == 2 && out_curves.size() == 0) {//case ->*<-
-				//copy the first in curve
-				EdgeProperties new_prop = in_curves[0];
-
-				GRuint second_curve_size((GRuint)in_curves[1].curve.size());
 
-				//update the tangent
-				new_prop.curve.back().second = (in_curves[1].curve[second_curve_size - 2].first - new_prop.curve.back().first).normalize();
+			//and merge them together in a way that depends on their direction (->*<- ,  <-*->, ->*-> or <-*<-) :
+			//the first curve is oriented towards the removed vertex and the second one away from it
+			bool reverse_first = boost::target(edges[0], internal_graph_) != vertex_to_remove;//case <-*->
+			bool reverse_second = boost::source(edges[1], internal_graph_) != vertex_to_remove;//case ->*<-
 
-				//add the second in curve in reverse order (and with the tangents in opposite direction
-				for (GRuint i(1); i < second_curve_size; i++) {
-					new_prop.curve.push_back(
-						PointTangent(
-							in_curves[1].curve[second_curve_size - 1 - i].first,
-							in_curves[1].curve[second_curve_size - 1 - i].second * (-1.f)
-						)
-					);
-				}
+			VertexDescriptor new_source = reverse_first ? boost::target(edges[0], internal_graph_) : boost::source(edges[0], internal_graph_);
+			VertexDescriptor new_target = reverse_second ? boost::source(edges[1], internal_graph_) : boost::target(edges[1], internal_graph_);
 
-				//add the new curve
-				new_curve = new_prop;
+			const DeformableSplineCurve& second_curve = get_edge(edges[1]).curve;
+			GRuint second_curve_size((GRuint)second_curve.size());
 
-				//and add the new source and target
-				new_source = sources[0];
-				new_target = sources[1];
+			//steal the first curve. Its spline count is removed here since it won't be there anymore when the vertex is removed
+			EdgeProperties new_prop;
+			new_prop.curve = std::move(get_edge(edges[0]).curve);
+			edge_spline_count_ -= (GRuint)new_prop.curve.size();
 
-			}
-			else if (in_curves.size() == 0 && out_curves.size() == 2) {//case <-*->
-				GRuint first_curve_size((GRuint)out_curves[0].curve.size());
-
-				std::vector<PointTangent> first_half;
-				//add the first in curve in reverse order (and with the tangents in opposite direction
-				for (GRuint i(0); i < first_curve_size; i++) {
-					first_half.push_back(
-						PointTangent(
-							out_curves[0].curve[first_curve_size - 1 - i].first,
-							out_curves[0].curve[first_curve_size - 1 - i].second * (-1.f)
-						)
-);
+			if (reverse_first) {
+				std::reverse(new_prop.curve.begin(), new_prop.curve.end());
+				for (auto& point_tangent : new_prop.curve) {
+					point_tangent.second *= -1.f;
 				}
+			}
 
-				EdgeProperties new_prop;
-				new_prop.curve = first_half;
-
-				//update the tangent
-				new_prop.curve.back().second = (out_curves[1].curve[1].first - new_prop.curve.back().first).normalize();
-
-				GRuint second_curve_size((GRuint)out_curves[1].curve.size());
+			//update the tangent (we don't take the first PointTangent of the second curve since it's the same as
+			//the last of the first curve. i.e. the removed vertex' position)
+			const Vector3f& next_point = reverse_second ? second_curve[second_curve_size - 2].first : second_curve[1].first;
+			new_prop.curve.back().second = (next_point - new_prop.curve.back().first).normalize();
 
-				//add the second in curve in standard order (except the first element)
+			//add the second curve (in reverse order and with the tangents in opposite direction if needed)
+			new_prop.curve.reserve(new_prop.curve.size() + second_curve_size - 1);
+			if (reverse_second) {
 				for (GRuint i(1); i < second_curve_size; i++) {
 					new_prop.curve.push_back(
 						PointTangent(
-							out_curves[1].curve[i].first,
-							out_curves[1].curve[i].second
+							second_curve[second_curve_size - 1 - i].first,
+							second_curve[second_curve_size - 1 - i].second * (-1.f)
 						)
 					);
 				}
-
-				//add the new curve
-				new_curve = new_prop;
-
-				//and add the new source and target
-				new_source = targets[0];
-				new_target = targets[1];
-
 			}
 			else {
-			throw std::runtime_error("Could not create new edge to replace vertex of degree 2");
+				new_prop.curve.insert(new_prop.curve.end(), second_curve.begin() + 1, second_curve.end());
 			}
 
-			if (new_source != VertexDescriptor() && new_target != VertexDescriptor()) {
-				//add an edge from the in-edge's source to the out-edge's target
-				std::pair<EdgeDescriptor, bool> new_edge = add_edge(new_source, new_target, { new_curve });
+			//the original shape of the first curve doesn't match the merged curve
+			new_prop.curve.release_original_shape();
 
-				//remove the vertex (and both in and out-edges)
-				EdgeVector removed_edges = remove_vertex(vertex_to_remove);
+			//add an edge from the new source to the new target
+			std::pair<EdgeDescriptor, bool> new_edge = add_edge(new_source, new_target, std::move(new_prop));
 
-				//std::cout << "edge count : " << edge_count() << std::endl;
-				//std::cout << " new edge length : " << new_curve.size() << std::endl;
-				if (new_edge.second && removed_edges.size() == 2) {
-					return std::pair<EdgeDescriptor, EdgePair>(new_edge.first, EdgePair(removed_edges[0], removed_edges[1]));
-				}
+			//remove the vertex (and both in and out-edges)
+			EdgeVector removed_edges = remove_vertex(vertex_to_remove);
+
+			if (new_edge.second && removed_edges.size() == 2) {
+				return std::pair<EdgeDescriptor, EdgePair>(new_edge.first, EdgePair(removed_edges[0], removed_edges[1]));
 			}
 
 			throw std::runtime_error("Could not create new edge to replace vertex of degree 2");
@@ -2181,10 +2674,8 @@ shortest_path(source_edge_target, target_edge_target)
 			for (next = vi; vi != vi_end; vi = next) {
 				++next;
 				InternalBoostGraph::degree_size_type degree = this->degree(*vi);
-				std::cout << " vertex " << iteration_count << std::endl;
-				std::cout << "in degree : " << boost::in_degree(*vi, internal_graph_) << std::endl;
-				std::cout << "out degree : " << boost::out_degree(*vi, internal_graph_) << std::endl;
-				std::cout << "degree : " << degree << std::endl << std::endl;;
+				GR_LOG_DEBUG(" vertex " << iteration_count << " : in degree " << boost::in_degree(*vi, internal_graph_)
+					<< ", out degree " << boost::out_degree(*vi, internal_graph_) << ", degree " << degree);
 				iteration_count++;
 				if (degree == 2) {
 
@@ -2304,7 +2795,7 @@ shortest_path(source_edge_target, target_edge_target)
 						new_targets.push_back(targets[1]);
 
 					}else{
-						std::cerr << " THIS SHOULDN'T HAVE HAPPENED. EXITING" << std::endl;
+						GR_LOG_ERROR(" THIS SHOULDN'T HAVE HAPPENED. EXITING");
 						exit(EXIT_FAILURE);
 
 					}
@@ -2317,7 +2808,7 @@ shortest_path(source_edge_target, target_edge_target)
 
 			//return;
 			if (new_sources.size() != new_targets.size() || new_sources.size() != new_props.size()) {
-				std::cerr << " THIS SHOULDN'T HAVE HAPPENED. EXITING" << std::endl;
+				GR_LOG_ERROR(" THIS SHOULDN'T HAVE HAPPENED. EXITING");
 				exit(EXIT_FAILURE);
 			}
 
@@ -2339,7 +2830,8 @@ shortest_path(source_edge_target, target_edge_target)
 		}*/
 
 
-		void move_and_scale(Vector3f displacement, GRfloat scale_factor) {
+		/** Moves and scales the whole graph. The curves are transformed on thread_count threads (0 uses all the hardware threads)*/
+		void move_and_scale(Vector3f displacement, GRfloat scale_factor, GRuint thread_count = 0) {
 
 			std::pair<VertexIterator, VertexIterator> vp;
 
@@ -2348,14 +2840,151 @@ shortest_path(source_edge_target, target_edge_target)
 				internal_graph_[v].position = (internal_graph_[v].position + displacement)*scale_factor;
 			}
 
+			EdgeVector edges;
+			edges.reserve(edge_count());
 			std::pair<EdgeIterator, EdgeIterator> ep;
 			for (ep = boost::edges(internal_graph_); ep.first != ep.second; ++ep.first) {
-				EdgeDescriptor e = *ep.first;
-				for (auto& point_tangent : internal_graph_[e].curve) {
+				edges.push_back(*ep.first);
+			}
+			parallel_for(0, (GRuint)edges.size(), [&](GRuint i) {
+				DeformableSplineCurve& curve = internal_graph_[edges[i]].curve;
+				for (auto& point_tangent : curve) {
 					point_tangent.first = (point_tangent.first + displacement)*scale_factor;
 				}
-				internal_graph_[e].curve.update_tangents();
+				curve.update_tangents();
+			}, thread_count);
+			geometry_changed();
+		}
+
+
+		/******************************************************************************************** Spatial queries */
+
+		/** The queries below are const but rebuild or refit the spatial index when the graph changed since the last query,
+		so they are NOT thread-safe on their own : two threads querying the same graph may update the index at the same time.
+		Call this once (from a single thread) after the last modification, the queries then only read the index
+		and can run concurrently until the graph is modified again*/
+		void prepare_spatial_queries() const {
+			update_spatial_index();
+		}
+
+		/** Rebuilds the spatial index from scratch. This is done automatically by the queries after a structural change*/
+		void rebuild_spatial_index() const {
+			std::vector<SegmentBVH<SpatialIndexEntry>::Segment> vertex_segments;
+			vertex_segments.reserve(vertex_count());
+
+			std::pair<VertexIterator, VertexIterator> vp;
+			for (vp = boost::vertices(internal_graph_); vp.first != vp.second; ++vp.first) {
+				Vector3f position = internal_graph_[*vp.first].position;
+				vertex_segments.push_back({ position, position, { *vp.first, EdgeDescriptor(), 0 } });
+			}
+
+			std::vector<SegmentBVH<SpatialIndexEntry>::Segment> edge_segments;
+			edge_segments.reserve(edge_spline_count_);
+
+			std::pair<EdgeIterator, EdgeIterator> ep;
+			for (ep = boost::edges(internal_graph_); ep.first != ep.second; ++ep.first) {
+				const DeformableSplineCurve& curve = internal_graph_[*ep.first].curve;
+				for (GRuint i(0); i + 1 < curve.size(); i++) {
+					edge_segments.push_back({ curve[i].first, curve[i + 1].first, { null_vertex(), *ep.first, i } });
+				}
+			}
+
+			vertex_index_.build(std::move(vertex_segments));
+			edge_index_.build(std::move(edge_segments));
+
+			spatial_index_needs_rebuild_ = false;
+			spatial_index_needs_refit_ = false;
+		}
+
+		/** Reads the current positions and updates the bounding boxes of the spatial index without changing its structure.
+		This is done automatically by the queries after vertices were moved or edges deformed*/
+		void refit_spatial_index() const {
+			if (spatial_index_needs_rebuild_) {
+				rebuild_spatial_index();
+				return;
+			}
+
+			for (GRuint i(0); i < vertex_index_.size(); i++) {
+				auto& segment = vertex_index_.segment(i);
+				segment.start = internal_graph_[segment.payload.vertex].position;
+				segment.end = segment.start;
+			}
+
+			for (GRuint i(0); i < edge_index_.size(); i++) {
+				auto& segment = edge_index_.segment(i);
+				const DeformableSplineCurve& curve = internal_graph_[segment.payload.edge].curve;
+
+				//the curve lost some points without being flagged as a structural change
+				if (segment.payload.spline_index + 1 >= curve.size()) {
+					rebuild_spatial_index();
+					return;
+				}
+				segment.start = curve[segment.payload.spline_index].first;
+				segment.end = curve[segment.payload.spline_index + 1].first;
+			}
+
+			vertex_index_.refit();
+			edge_index_.refit();
+
+			spatial_index_needs_refit_ = false;
+		}
+
+		/** To be called after modifying the vertices or edges directly through get_vertex() or get_edge()
+		\param structure whether points were added to or removed from the curves (a refit is enough otherwise)*/
+		void invalidate_spatial_index(bool structure = true) {
+			if (structure) {
+				structure_changed();
+			}
+			else {
+				geometry_changed();
+			}
+		}
+
+		/** Returns null_vertex() if no vertex is closer than max_distance*/
+		VertexDescriptor nearest_vertex(Vector3f point, GRfloat max_distance = FLT_MAX) const {
+			update_spatial_index();
+
+			SegmentBVH<SpatialIndexEntry>::Hit hit;
+			if (vertex_index_.nearest(point, hit, max_distance)) {
+				return vertex_index_.segment(hit.segment_index).payload.vertex;
+			}
+			return null_vertex();
+		}
+
+		/** Finds the closest point on any edge's curve (with the splines approximated by straight segments).
+		Returns false if no edge is closer than max_distance*/
+		bool nearest_edge_point(Vector3f point, EdgePoint& edge_point, GRfloat max_distance = FLT_MAX) const {
+			update_spatial_index();
+
+			SegmentBVH<SpatialIndexEntry>::Hit hit;
+			if (edge_index_.nearest(point, hit, max_distance)) {
+				const SpatialIndexEntry& entry = edge_index_.segment(hit.segment_index).payload;
+				edge_point = { entry.edge, entry.spline_index, hit.parameter, hit.position, hit.distance };
+				return true;
+			}
+			return false;
+		}
+
+		VertexVector vertices_within_radius(Vector3f point, GRfloat radius) const {
+			update_spatial_index();
+
+			VertexVector vertices;
+			for (auto& hit : vertex_index_.within_radius(point, radius)) {
+				vertices.push_back(vertex_index_.segment(hit.segment_index).payload.vertex);
+			}
+			return vertices;
+		}
+
+		/** Returns the closest point of every spline passing within radius of the point (so an edge can appear several times)*/
+		std::vector<EdgePoint> edge_points_within_radius(Vector3f point, GRfloat radius) const {
+			update_spatial_index();
+
+			std::vector<EdgePoint> edge_points;
+			for (auto& hit : edge_index_.within_radius(point, radius)) {
+				const SpatialIndexEntry& entry = edge_index_.segment(hit.segment_index).payload;
+				edge_points.push_back({ entry.edge, entry.spline_index, hit.parameter, hit.position, hit.distance });
 			}
+			return edge_points;
 		}
 
 		
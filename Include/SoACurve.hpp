@@ -0,0 +1,155 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <vector>
+
+#include "Curve.hpp"
+#include "CurveKernels.hpp"
+
+namespace grapholon {
+
+	/** A curve stored as a structure of arrays : the x, y and z coordinates of its points and of its tangents each
+	have their own contiguous array. This is what the geometry kernels (see CurveKernels.hpp) work on.
+	Use it for heavy computations on long curves, converting from and back to SplineCurve or DiscreteCurve*/
+	class SoACurve {
+	private:
+		std::vector<GRfloat> x_, y_, z_;
+		std::vector<GRfloat> tx_, ty_, tz_;
+
+	public:
+		SoACurve() {}
+
+		explicit SoACurve(const SplineCurve& curve) {
+			assign(curve);
+		}
+
+		/** The tangents are computed from the points, like SplineCurve(std::vector<Vector3f>) does*/
+		explicit SoACurve(const DiscreteCurve& curve) {
+			assign(curve);
+		}
+
+		void assign(const SplineCurve& curve) {
+			resize(curve.size());
+			for (GRuint i(0); i < curve.size(); i++) {
+				set_point(i, curve[i].first);
+				set_tangent(i, curve[i].second);
+			}
+		}
+
+		void assign(const DiscreteCurve& curve) {
+			resize(curve.size());
+			vector_batch::deinterleave(curve.data(), curve.size(), x_.data(), y_.data(), z_.data());
+			if (size() >= 2) {
+				update_tangents();
+			}
+		}
+
+		/** Writes the points and tangents back in 'curve', which is resized to this curve's size*/
+		void to_spline_curve(SplineCurve& curve) const {
+			curve.resize(size());
+			for (GRuint i(0); i < size(); i++) {
+				curve[i].first = point(i);
+				curve[i].second = tangent(i);
+			}
+		}
+
+		DiscreteCurve to_discrete_curve() const {
+			DiscreteCurve curve(size());
+			vector_batch::interleave(x_.data(), y_.data(), z_.data(), size(), curve.data());
+			return curve;
+		}
+
+		size_t size() const {
+			return x_.size();
+		}
+
+		void resize(size_t size) {
+			x_.resize(size);
+			y_.resize(size);
+			z_.resize(size);
+			tx_.resize(size);
+			ty_.resize(size);
+			tz_.resize(size);
+		}
+
+		Vector3f point(GRuint i) const {
+			return Vector3f(x_[i], y_[i], z_[i]);
+		}
+
+		Vector3f tangent(GRuint i) const {
+			return Vector3f(tx_[i], ty_[i], tz_[i]);
+		}
+
+		void set_point(GRuint i, const Vector3f& point) {
+			x_[i] = point.X();
+			y_[i] = point.Y();
+			z_[i] = point.Z();
+		}
+
+		void set_tangent(GRuint i, const Vector3f& tangent) {
+			tx_[i] = tangent.X();
+			ty_[i] = tangent.Y();
+			tz_[i] = tangent.Z();
+		}
+
+		const GRfloat* x() const { return x_.data(); }
+		const GRfloat* y() const { return y_.data(); }
+		const GRfloat* z() const { return z_.data(); }
+		const GRfloat* tangent_x() const { return tx_.data(); }
+		const GRfloat* tangent_y() const { return ty_.data(); }
+		const GRfloat* tangent_z() const { return tz_.data(); }
+
+
+		/************************************************************************************************ Kernels */
+
+		/** Sum of the segments' lengths (see SplineCurve::length())*/
+		GRfloat length() const {
+			return curve_kernels::length(x_.data(), y_.data(), z_.data(), (GRuint)size());
+		}
+
+		/** Same tangents as SplineCurve::update_tangents() : central differences inside, one-sided ones at the ends*/
+		void update_tangents(bool normalize = true) {
+			curve_kernels::tangents(x_.data(), y_.data(), z_.data(), tx_.data(), ty_.data(), tz_.data(), (GRuint)size(), normalize);
+		}
+
+		/** Index of the point of [start, end] furthest from the line (from, to) and its distance in max_distance
+		(see DiscreteCurve::furthest_point_to_line_index). When from and to are (almost) the same point, the distance
+		to that point is used instead. Returns (GRuint)-1 if the range is not valid*/
+		GRuint furthest_point_to_line_index(GRuint start, GRuint end, Vector3f from, Vector3f to, GRfloat& max_distance) const {
+			if (start > end || end >= size()) {
+				max_distance = -std::numeric_limits<GRfloat>::max();
+				return (GRuint)-1;
+			}
+			return curve_kernels::furthest_point_to_line_index(x_.data(), y_.data(), z_.data(), start, end, from, to, max_distance);
+		}
+
+		/** Index of the point of [start, end] nearest to 'point' (see DiscreteCurve::nearest_point_index).
+		Returns (GRuint)-1 if the range is not valid*/
+		GRuint nearest_point_index(GRuint start, GRuint end, Vector3f point) const {
+			if (start > end || end >= size()) {
+				return (GRuint)-1;
+			}
+			return curve_kernels::nearest_point_index(x_.data(), y_.data(), z_.data(), start, end, point);
+		}
+	};
+}
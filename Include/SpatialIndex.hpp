@@ -0,0 +1,301 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#include "GrapholonTypes.hpp"
+#include "Vector.hpp"
+
+namespace grapholon {
+
+#define BVH_MAX_LEAF_SIZE 4
+
+	/** A bounding volume hierarchy over straight segments. Points are stored as degenerate segments (start == end).
+	Each segment carries a payload identifying what it stands for (e.g. a vertex or an edge's spline).
+	The tree is built top-down by splitting at the median along the largest axis of the centroids' bounding box.
+	When only the segments' positions change, refit() updates the boxes without rebuilding the tree*/
+	template<typename Payload>
+	class SegmentBVH {
+	public:
+		struct Segment {
+			Vector3f start;
+			Vector3f end;
+			Payload payload;
+		};
+
+		/** closest point found by a query*/
+		struct Hit {
+			GRuint segment_index;
+			GRfloat distance;
+			GRfloat parameter;///<in [0,1] along the segment
+			Vector3f position;
+		};
+
+	private:
+		/** inner nodes have count == 0, their left child is right after them and right_child is the index of the right one*/
+		struct Node {
+			GRfloat min[3];
+			GRfloat max[3];
+			GRuint first;
+			GRuint count;
+			GRuint right_child;
+		};
+
+		std::vector<Segment> segments_;
+		std::vector<Node> nodes_;
+
+		static GRfloat coordinate(const Vector3f& point, GRuint axis) {
+			return axis == 0 ? point.X() : axis == 1 ? point.Y() : point.Z();
+		}
+
+		static void set_box(Node& node, const Segment& segment) {
+			for (GRuint axis(0); axis < 3; axis++) {
+				node.min[axis] = std::min(coordinate(segment.start, axis), coordinate(segment.end, axis));
+				node.max[axis] = std::max(coordinate(segment.start, axis), coordinate(segment.end, axis));
+			}
+		}
+
+		static void grow_box(Node& node, const GRfloat min[3], const GRfloat max[3]) {
+			for (GRuint axis(0); axis < 3; axis++) {
+				node.min[axis] = std::min(node.min[axis], min[axis]);
+				node.max[axis] = std::max(node.max[axis], max[axis]);
+			}
+		}
+
+		void compute_leaf_box(Node& node) const {
+			set_box(node, segments_[node.first]);
+			for (GRuint i(node.first + 1); i < node.first + node.count; i++) {
+				Node segment_box;
+				set_box(segment_box, segments_[i]);
+				grow_box(node, segment_box.min, segment_box.max);
+			}
+		}
+
+		static GRfloat squared_distance_to_box(const Node& node, const Vector3f& point) {
+			GRfloat squared_distance(0.f);
+			for (GRuint axis(0); axis < 3; axis++) {
+				GRfloat value = coordinate(point, axis);
+				GRfloat delta = value < node.min[axis] ? node.min[axis] - value : value > node.max[axis] ? value - node.max[axis] : 0.f;
+				squared_distance += delta * delta;
+			}
+			return squared_distance;
+		}
+
+		GRuint build_node(GRuint first, GRuint count) {
+			GRuint node_index = (GRuint)nodes_.size();
+			nodes_.push_back(Node());
+
+			if (count <= BVH_MAX_LEAF_SIZE) {
+				nodes_[node_index].first = first;
+				nodes_[node_index].count = count;
+				nodes_[node_index].right_child = 0;
+				compute_leaf_box(nodes_[node_index]);
+				return node_index;
+			}
+
+			//split along the largest axis of the centroids' bounding box
+			GRfloat centroid_min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			GRfloat centroid_max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (GRuint i(first); i < first + count; i++) {
+				for (GRuint axis(0); axis < 3; axis++) {
+					GRfloat centroid = coordinate(segments_[i].start, axis) + coordinate(segments_[i].end, axis);
+					centroid_min[axis] = std::min(centroid_min[axis], centroid);
+					centroid_max[axis] = std::max(centroid_max[axis], centroid);
+				}
+			}
+			GRuint split_axis(0);
+			for (GRuint axis(1); axis < 3; axis++) {
+				if (centroid_max[axis] - centroid_min[axis] > centroid_max[split_axis] - centroid_min[split_axis]) {
+					split_axis = axis;
+				}
+			}
+
+			GRuint half = count / 2;
+			std::nth_element(segments_.begin() + first, segments_.begin() + first + half, segments_.begin() + first + count,
+				[split_axis](const Segment& a, const Segment& b) {
+				return coordinate(a.start, split_axis) + coordinate(a.end, split_axis)
+					< coordinate(b.start, split_axis) + coordinate(b.end, split_axis);
+			});
+
+			build_node(first, half);
+			GRuint right_child = build_node(first + half, count - half);
+
+			//NOTE : nodes_ may have been reallocated by the recursive calls
+			Node& node = nodes_[node_index];
+			node.first = first;
+			node.count = 0;
+			node.right_child = right_child;
+			std::copy(nodes_[node_index + 1].min, nodes_[node_index + 1].min + 3, node.min);
+			std::copy(nodes_[node_index + 1].max, nodes_[node_index + 1].max + 3, node.max);
+			grow_box(node, nodes_[right_child].min, nodes_[right_child].max);
+
+			return node_index;
+		}
+
+		static Hit closest_point_on_segment(const Segment& segment, GRuint segment_index, const Vector3f& point) {
+			Vector3f direction = segment.end - segment.start;
+			GRfloat squared_length = direction.dot(direction);
+			GRfloat parameter(0.f);
+			if (squared_length > FLT_EPSILON) {
+				parameter = std::max(0.f, std::min(1.f, (point - segment.start).dot(direction) / squared_length));
+			}
+			Vector3f position = segment.start + direction * parameter;
+			return { segment_index, position.distance(point), parameter, position };
+		}
+
+	public:
+		SegmentBVH() {}
+
+		/** Takes ownership of the segments. NOTE : their order is changed by the build*/
+		void build(std::vector<Segment> segments) {
+			segments_ = std::move(segments);
+			nodes_.clear();
+			if (segments_.size()) {
+				nodes_.reserve(2 * (segments_.size() / BVH_MAX_LEAF_SIZE + 1));
+				build_node(0, (GRuint)segments_.size());
+			}
+		}
+
+		/** Recomputes all the boxes bottom-up. To be called after updating the segments' positions in place*/
+		void refit() {
+			//children always come after their parent
+			for (GRuint i((GRuint)nodes_.size()); i-- > 0;) {
+				Node& node = nodes_[i];
+				if (node.count) {
+					compute_leaf_box(node);
+				}
+				else {
+					std::copy(nodes_[i + 1].min, nodes_[i + 1].min + 3, node.min);
+					std::copy(nodes_[i + 1].max, nodes_[i + 1].max + 3, node.max);
+					grow_box(node, nodes_[node.right_child].min, nodes_[node.right_child].max);
+				}
+			}
+		}
+
+		void clear() {
+			segments_.clear();
+			nodes_.clear();
+		}
+
+		GRuint size() const {
+			return (GRuint)segments_.size();
+		}
+
+		const Segment& segment(GRuint index) const {
+			return segments_[index];
+		}
+
+		/** Use this to update the positions before calling refit()*/
+		Segment& segment(GRuint index) {
+			return segments_[index];
+		}
+
+		/** Returns false if no segment is closer than max_distance*/
+		bool nearest(const Vector3f& point, Hit& hit, GRfloat max_distance = FLT_MAX) const {
+			if (!nodes_.size()) {
+				return false;
+			}
+
+			bool found(false);
+			GRfloat best_squared_distance = max_distance < sqrtf(FLT_MAX) ? max_distance * max_distance : FLT_MAX;
+
+			std::vector<GRuint> stack;
+			stack.reserve(64);
+			stack.push_back(0);
+			while (stack.size()) {
+				const Node& node = nodes_[stack.back()];
+				GRuint node_index = stack.back();
+				stack.pop_back();
+
+				if (squared_distance_to_box(node, point) > best_squared_distance) {
+					continue;
+				}
+
+				if (node.count) {
+					for (GRuint i(node.first); i < node.first + node.count; i++) {
+						Hit candidate = closest_point_on_segment(segments_[i], i, point);
+						if (candidate.distance * candidate.distance <= best_squared_distance) {
+							best_squared_distance = candidate.distance * candidate.distance;
+							hit = candidate;
+							found = true;
+						}
+					}
+				}
+				else {
+					//visit the closest child first
+					GRuint left_child = node_index + 1;
+					GRfloat left_distance = squared_distance_to_box(nodes_[left_child], point);
+					GRfloat right_distance = squared_distance_to_box(nodes_[node.right_child], point);
+					if (left_distance < right_distance) {
+						stack.push_back(node.right_child);
+						stack.push_back(left_child);
+					}
+					else {
+						stack.push_back(left_child);
+						stack.push_back(node.right_child);
+					}
+				}
+			}
+			return found;
+		}
+
+		/** Returns all segments that pass within radius of the point (unordered)*/
+		std::vector<Hit> within_radius(const Vector3f& point, GRfloat radius) const {
+			std::vector<Hit> hits;
+			if (!nodes_.size()) {
+				return hits;
+			}
+
+			GRfloat squared_radius = radius * radius;
+
+			std::vector<GRuint> stack;
+			stack.reserve(64);
+			stack.push_back(0);
+			while (stack.size()) {
+				GRuint node_index = stack.back();
+				const Node& node = nodes_[node_index];
+				stack.pop_back();
+
+				if (squared_distance_to_box(node, point) > squared_radius) {
+					continue;
+				}
+
+				if (node.count) {
+					for (GRuint i(node.first); i < node.first + node.count; i++) {
+						Hit candidate = closest_point_on_segment(segments_[i], i, point);
+						if (candidate.distance <= radius) {
+							hits.push_back(candidate);
+						}
+					}
+				}
+				else {
+					stack.push_back(node_index + 1);
+					stack.push_back(node.right_child);
+				}
+			}
+			return hits;
+		}
+	};
+}
@@ -21,10 +21,19 @@
 //
 #pragma once
 
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
 #include "GrapholonTypes.hpp"
 #include "common.hpp"
 
 namespace grapholon {
+	/** Fixed size vector. It is trivially copyable and holds nothing else than its coordinates, so arrays of vectors
+	can be copied with memcpy and read as arrays of _SIZE * n coordinates*/
 	template<typename _TYPE, GRuint _SIZE>
 	class Vector {
 		static_assert(_SIZE > 0, "Cannot create zero-sized Vector");
@@ -34,13 +43,15 @@ namespace grapholon {
 	protected:
 		_TYPE data_[_SIZE];
 
-		int data2;
+		struct Values {};
+
+		template<typename... _VALUES>
+		constexpr Vector(Values, _VALUES... values) : data_{ values... } {}
 
 	public:
 
-		Vector() {
-			std::memset(data_, 0, _SIZE * sizeof(_TYPE));
-		}
+		/** All coordinates are zero*/
+		constexpr Vector() : data_() {}
 
 
 		//string stuff
@@ -74,72 +85,53 @@ namespace grapholon {
 
 
 
-		Vector3() : Vector<_TYPE, 3>() {}
+		constexpr Vector3() : Vector<_TYPE, 3>() {}
 
-		Vector3(_TYPE x, _TYPE y, _TYPE z) {
-			X() = x;
-			Y() = y;
-			Z() = z;
-		}
+		constexpr Vector3(_TYPE x, _TYPE y, _TYPE z) : Vector<_TYPE, 3>(typename Vector<_TYPE, 3>::Values(), x, y, z) {}
 
 		template <typename _OTHER_TYPE>
-		Vector3(_OTHER_TYPE x, _OTHER_TYPE y, _OTHER_TYPE z) : Vector3((_TYPE)x, (_TYPE)y, (_TYPE)z) {}
-
-		Vector3(_TYPE value) : Vector3(value, value, value) {}
-
-		/**Copy constructor to avoid the side effect of copying the member reference X(),Y()& Z()*/
-		Vector3(const Vector3& other) {
-			X() = other.X();
-			Y()= other.Y();
-			Z() = other.Z();
-		}
+		constexpr Vector3(_OTHER_TYPE x, _OTHER_TYPE y, _OTHER_TYPE z) : Vector3((_TYPE)x, (_TYPE)y, (_TYPE)z) {}
 
+		constexpr Vector3(_TYPE value) : Vector3(value, value, value) {}
 
-
-		_TYPE& X() {
+		constexpr _TYPE& X() {
 			return Vector<_TYPE, 3>::data_[0];
 		}
 
-		_TYPE& Y() {
+		constexpr _TYPE& Y() {
 			return Vector<_TYPE, 3>::data_[1];
 		}
 
-		_TYPE& Z() {
+		constexpr _TYPE& Z() {
 			return Vector<_TYPE, 3>::data_[2];
 		}
 
-		const _TYPE& X() const {
+		constexpr const _TYPE& X() const {
 			return Vector<_TYPE, 3>::data_[0];
 		}
 
-		const _TYPE& Y() const {
+		constexpr const _TYPE& Y() const {
 			return Vector<_TYPE, 3>::data_[1];
 		}
 
-		const _TYPE& Z() const {
+		constexpr const _TYPE& Z() const {
 			return Vector<_TYPE, 3>::data_[2];
 		}
 
 		//math operators
-		void operator=(const _Vector3& other) {
-			X() = other.X();
-			Y() = other.Y();
-			Z() = other.Z();
-		}
-
-		_Vector3 operator+(const _Vector3& other) const {
+		constexpr _Vector3 operator+(const _Vector3& other) const {
 			return _Vector3(X() + other.X(), Y()+ other.Y(), Z() + other.Z());
 		}
 
-		_Vector3 operator-(const _Vector3& other) const {
+		constexpr _Vector3 operator-(const _Vector3& other) const {
 			return _Vector3(X() - other.X(), Y()- other.Y(), Z() - other.Z());
 		}
 
-		_Vector3 operator*(const _TYPE& scalar) const {
+		constexpr _Vector3 operator*(const _TYPE& scalar) const {
 			return _Vector3(X()*scalar, Y()*scalar, Z()*scalar);
 		}
 
-		_Vector3 operator/(const _TYPE& scalar) const {
+		constexpr _Vector3 operator/(const _TYPE& scalar) const {
 			return _Vector3(X() / scalar, Y()/ scalar, Z() / scalar);
 		}
 
@@ -163,17 +155,22 @@ namespace grapholon {
 			return *this;
 		}
 
-		_TYPE dot(const _Vector3& other) const {
+		constexpr _TYPE dot(const _Vector3& other) const {
 			return X()*other.X() + Y()*other.Y()+ Z()*other.Z();
 		}
 
-		_Vector3 cross(const _Vector3& other) const {
+		constexpr _Vector3 cross(const _Vector3& other) const {
 			return _Vector3(
 				Y()*other.Z() - Z()*other.Y(),
 				Z()*other.X() - X()*other.Z(),
 				X()*other.Y()- Y()*other.X());
 		}
 
+		/** Can be used in constant expressions, unlike norm() (sqrtf isn't constexpr)*/
+		constexpr _TYPE squared_norm() const {
+			return this->dot(*this);
+		}
+
 		GRfloat norm() const {
 			return sqrtf((GRfloat)(this->dot(*this)));
 		}
@@ -183,12 +180,12 @@ namespace grapholon {
 			return _norm > FLT_EPSILON ? (*this) /= norm() : (*this);
 		}
 
-		Vector3<GRfloat> normalized() {
+		Vector3<GRfloat> normalized() const {
 			GRfloat _norm(norm());
 			return _norm > FLT_EPSILON ? (*this) / norm() : (*this);
 		}
 
-		static _Vector3 axis_vector(AXIS axis) {
+		static constexpr _Vector3 axis_vector(AXIS axis) {
 			return _Vector3(axis == X_AXIS, axis == Y_AXIS, axis == Z_AXIS);
 		}
 
@@ -196,6 +193,10 @@ namespace grapholon {
 			return ((*this) - other).norm();
 		}
 
+		constexpr _TYPE squared_distance(const _Vector3& other) const {
+			return ((*this) - other).squared_norm();
+		}
+
 		GRfloat distance_to_line(const Vector3<GRfloat>& from, const Vector3<GRfloat>& to) const {
 			return fabs(((*this) - from).cross((*this) - to).norm() / (to - from).norm());
 		}
@@ -236,4 +237,42 @@ namespace grapholon {
 	typedef Vector3<GRint> Vector3d;
 	typedef Vector3<GRuint> Vector3u;
 
+	static_assert(std::is_trivially_copyable<Vector3f>::value, "Vector3f must be trivially copyable");
+	static_assert(sizeof(Vector3f) == 3 * sizeof(GRfloat), "Vector3f must only hold its coordinates");
+
+
+	/************************************************************************************************ Batch operations */
+
+	/** Conversions between arrays of vectors (pointer and count) and structures of arrays, for the kernels
+	that work on one coordinate at a time (see SoACurve.hpp and CurveKernels.hpp)*/
+	namespace vector_batch {
+
+		inline const GRfloat* coordinates(const Vector3f* vectors) {
+			return reinterpret_cast<const GRfloat*>(vectors);
+		}
+
+		inline GRfloat* coordinates(Vector3f* vectors) {
+			return reinterpret_cast<GRfloat*>(vectors);
+		}
+
+		/** Splits the vectors' coordinates into three arrays (structure of arrays)*/
+		inline void deinterleave(const Vector3f* vectors, size_t count, GRfloat* x, GRfloat* y, GRfloat* z) {
+			const GRfloat* values = coordinates(vectors);
+			for (size_t i(0); i < count; i++) {
+				x[i] = values[3 * i];
+				y[i] = values[3 * i + 1];
+				z[i] = values[3 * i + 2];
+			}
+		}
+
+		/** Inverse of deinterleave()*/
+		inline void interleave(const GRfloat* x, const GRfloat* y, const GRfloat* z, size_t count, Vector3f* vectors) {
+			GRfloat* values = coordinates(vectors);
+			for (size_t i(0); i < count; i++) {
+				values[3 * i] = x[i];
+				values[3 * i + 1] = y[i];
+				values[3 * i + 2] = z[i];
+			}
+		}
+	}
 }
\ No newline at end of file
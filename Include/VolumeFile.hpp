@@ -0,0 +1,279 @@
+//Copyright (c) 2018 Valentin NIGOLIAN
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "GrapholonTypes.hpp"
+
+namespace grapholon {
+
+	/************************************************************************************************ Volume files */
+
+	typedef enum { VOLUME_UINT8, VOLUME_BIT } VolumeElementType;
+
+	/** Where to find the voxels of a volume and how they are stored.
+	The data is a dense array of width * height * slice elements, x varying fastest, then y, then z.
+	VOLUME_BIT volumes pack 8 voxels per byte, least significant bit first, without padding between rows*/
+	struct VolumeHeader {
+		GRuint width = 0;
+		GRuint height = 0;
+		GRuint slice = 0;
+		VolumeElementType element_type = VOLUME_UINT8;
+		GRfloat spacing[3] = { 1.f, 1.f, 1.f };///< size of a voxel along each axis (information only)
+		std::string data_file;///< may be the header file itself when the data is attached to it
+		long long data_offset = 0;///< position of the first voxel in data_file. -1 means that the data ends the file
+
+		size_t data_size() const {
+			size_t element_count = (size_t)width * height * slice;
+			return element_type == VOLUME_BIT ? (element_count + 7) / 8 : element_count;
+		}
+	};
+
+	/** Which values of an 8 bits volume make a voxel set : all values >= a threshold or a single label*/
+	struct VoxelSelection {
+		typedef enum { THRESHOLD, LABEL } Mode;
+
+		Mode mode;
+		GRuchar value;
+
+		static VoxelSelection threshold(GRuchar min_value) {
+			return { THRESHOLD, min_value };
+		}
+
+		static VoxelSelection label(GRuchar label_value) {
+			return { LABEL, label_value };
+		}
+	};
+
+
+	namespace volume_detail {
+		inline std::string trim(const std::string& text) {
+			size_t begin(0), end(text.size());
+			while (begin < end && std::isspace((unsigned char)text[begin])) {
+				begin++;
+			}
+			while (end > begin && std::isspace((unsigned char)text[end - 1])) {
+				end--;
+			}
+			return text.substr(begin, end - begin);
+		}
+
+		inline std::string to_lower(std::string text) {
+			std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+			return text;
+		}
+
+		/** Data file names are relative to the header's directory*/
+		inline std::string resolve_data_file(const std::string& header_filename, const std::string& data_file) {
+			if (data_file.size() && (data_file[0] == '/' || data_file[0] == '\\' || (data_file.size() > 1 && data_file[1] == ':'))) {
+				return data_file;
+			}
+			size_t separator = header_filename.find_last_of("/\\");
+			return separator == std::string::npos ? data_file : header_filename.substr(0, separator + 1) + data_file;
+		}
+
+		inline void read_dimensions(const std::string& text, VolumeHeader& header) {
+			std::istringstream stream(text);
+			long long width(0), height(0), slice(0);
+			stream >> width >> height >> slice;
+			if (stream.fail() || width <= 0 || height <= 0 || slice <= 0) {
+				throw std::runtime_error("ERROR - Only 3D volumes are supported (got sizes '" + text + "')");
+			}
+			header.width = (GRuint)width;
+			header.height = (GRuint)height;
+			header.slice = (GRuint)slice;
+		}
+
+		inline void read_spacing(const std::string& text, VolumeHeader& header) {
+			std::istringstream stream(text);
+			GRfloat spacing[3];
+			stream >> spacing[0] >> spacing[1] >> spacing[2];
+			if (!stream.fail()) {
+				std::copy(spacing, spacing + 3, header.spacing);
+			}
+		}
+
+		/** See http://teem.sourceforge.net/nrrd/format.html. Only raw unsigned 8 bits data is supported*/
+		inline VolumeHeader read_nrrd_header(std::ifstream& file, const std::string& filename) {
+			VolumeHeader header;
+			bool found_sizes(false);
+			std::string line;
+			while (std::getline(file, line)) {
+				if (line.size() && line.back() == '\r') {
+					line.pop_back();
+				}
+				//an empty line ends the header. The data follows if it is not detached
+				if (line.empty()) {
+					break;
+				}
+				if (line[0] == '#') {
+					continue;
+				}
+				size_t separator = line.find(':');
+				if (separator == std::string::npos) {
+					continue;
+				}
+				std::string field = to_lower(trim(line.substr(0, separator)));
+				//key/value pairs use ":=" and are ignored
+				if (separator + 1 < line.size() && line[separator + 1] == '=') {
+					continue;
+				}
+				std::string value = trim(line.substr(separator + 1));
+
+				if (field == "type") {
+					std::string type = to_lower(value);
+					if (type != "uchar" && type != "unsigned char" && type != "uint8" && type != "uint8_t") {
+						throw std::runtime_error("ERROR - Unsupported NRRD type '" + value + "' (only unsigned 8 bits volumes are supported)");
+					}
+				}
+				else if (field == "dimension") {
+					if (value != "3") {
+						throw std::runtime_error("ERROR - Only 3D volumes are supported (got dimension " + value + ")");
+					}
+				}
+				else if (field == "sizes") {
+					read_dimensions(value, header);
+					found_sizes = true;
+				}
+				else if (field == "encoding") {
+					if (to_lower(value) != "raw") {
+						throw std::runtime_error("ERROR - Unsupported NRRD encoding '" + value + "' (only raw data is supported)");
+					}
+				}
+				else if (field == "spacings") {
+					read_spacing(value, header);
+				}
+				else if (field == "byte skip") {
+					header.data_offset = std::atoll(value.c_str());
+				}
+				else if (field == "data file" || field == "datafile") {
+					if (value.find(' ') != std::string::npos || value == "LIST") {
+						throw std::runtime_error("ERROR - Multiple NRRD data files are not supported");
+					}
+					header.data_file = resolve_data_file(filename, value);
+				}
+			}
+			if (!found_sizes) {
+				throw std::runtime_error("ERROR - NRRD header has no sizes field");
+			}
+			if (header.data_file.empty()) {
+				header.data_file = filename;
+				if (header.data_offset >= 0) {
+					header.data_offset += (long long)file.tellg();
+				}
+			}
+			return header;
+		}
+
+		/** See https://itk.org/Wiki/ITK/MetaIO/Documentation. Only uncompressed MET_UCHAR data is supported*/
+		inline VolumeHeader read_meta_image_header(std::ifstream& file, const std::string& filename) {
+			VolumeHeader header;
+			bool found_sizes(false);
+			bool found_element_type(false);
+			std::string line;
+			while (std::getline(file, line)) {
+				size_t separator = line.find('=');
+				if (separator == std::string::npos) {
+					continue;
+				}
+				std::string field = to_lower(trim(line.substr(0, separator)));
+				std::string value = trim(line.substr(separator + 1));
+
+				if (field == "ndims") {
+					if (value != "3") {
+						throw std::runtime_error("ERROR - Only 3D volumes are supported (got NDims " + value + ")");
+					}
+				}
+				else if (field == "dimsize") {
+					read_dimensions(value, header);
+					found_sizes = true;
+				}
+				else if (field == "elementtype") {
+					if (value != "MET_UCHAR") {
+						throw std::runtime_error("ERROR - Unsupported element type '" + value + "' (only unsigned 8 bits volumes are supported)");
+					}
+					found_element_type = true;
+				}
+				else if (field == "compresseddata") {
+					if (to_lower(value) == "true") {
+						throw std::runtime_error("ERROR - Compressed MetaImage data is not supported");
+					}
+				}
+				else if (field == "elementspacing") {
+					read_spacing(value, header);
+				}
+				else if (field == "headersize") {
+					header.data_offset = std::atoll(value.c_str());
+				}
+				//always the last field
+				else if (field == "elementdatafile") {
+					if (value == "LOCAL") {
+						header.data_file = filename;
+						if (header.data_offset >= 0) {
+							header.data_offset += (long long)file.tellg();
+						}
+					}
+					else if (value == "LIST" || value.find('%') != std::string::npos) {
+						throw std::runtime_error("ERROR - Multiple MetaImage data files are not supported");
+					}
+					else {
+						header.data_file = resolve_data_file(filename, value);
+					}
+					break;
+				}
+			}
+			if (!found_sizes || header.data_file.empty()) {
+				throw std::runtime_error("ERROR - MetaImage header has no DimSize or ElementDataFile field");
+			}
+			if (!found_element_type) {
+				throw std::runtime_error("ERROR - MetaImage header has no ElementType field");
+			}
+			return header;
+		}
+	}
+
+	/** Reads a NRRD (.nrrd, .nhdr) or MetaImage (.mhd, .mha) header. The data may be attached or detached.
+	Throws a std::runtime_error if the file can't be read or describes something else than a raw 3D unsigned 8 bits volume*/
+	inline VolumeHeader read_volume_header(const std::string& filename) {
+		std::ifstream file(filename.c_str(), std::ios::binary);
+		if (!file.is_open()) {
+			throw std::runtime_error("ERROR - Could not open specified file");
+		}
+
+		std::string first_line;
+		std::getline(file, first_line);
+		if (first_line.compare(0, 4, "NRRD") == 0) {
+			return volume_detail::read_nrrd_header(file, filename);
+		}
+
+		file.clear();
+		file.seekg(0);
+		return volume_detail::read_meta_image_header(file, filename);
+	}
+}
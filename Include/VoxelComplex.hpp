@@ -27,9 +27,15 @@
 #include <algorithm>
 #include <iterator>
 #include <bitset>
+#include <cstdint>
+#include <functional>
+#include <limits>
 
 #include "GrapholonTypes.hpp"
+#include "GraphFile.hpp"
+#include "Parallel.hpp"
 #include "SkeletalGraph.hpp"
+#include "VolumeFile.hpp"
 #include "common.hpp"
 
 namespace grapholon {
@@ -48,7 +54,7 @@ namespace grapholon {
 #define MIN_SMOOTHING_THRESHOLD 0.1f
 #define MAX_SMOOTHING_THRESHOLD 1.f
 #define MIN_SMOOTHING_DISTANCE 0
-#define MAX_SMOOTHING_DISTANCE 2
+#define MAX_SMOOTHING_DISTANCE 16
 
 
 
@@ -74,6 +80,8 @@ namespace grapholon {
 	struct Voxel {
 		bool value_ = false;
 		bool selected_ = false;
+		bool listed_ = false;///< true if the voxel's id is in true_voxels_ (or waiting to be added to it by a batch)
+		bool anchor_ = false;///< anchors cannot be removed during thinning (see AnchoredSkel)
 		TopologicalClass topological_class_ = UNCLASSIFIED;
 
 		Voxel(bool value, bool selected, TopologicalClass top_class) 
@@ -98,7 +106,11 @@ namespace grapholon {
 
 		IndexVector true_voxels_;///< A vector containing the indices (within voxels_) of the voxels that are set or occupied. This allows for fast query of the actual complex
 
-		IndexVector anchor_voxels_;///< Voxels that cannot be removed during thinning. CURRENTLY NOT USED
+		GRuint anchor_count_ = 0;///< number of voxels with the anchor_ flag
+
+		bool batch_open_ = false;///< see begin_batch()
+		IndexVector batch_added_voxels_;///< voxels set during the batch, in order. Some may have been unset since
+		GRuint batch_removed_count_ = 0;///< voxels unset during the batch. They are still in true_voxels_
 
 
 	public:
@@ -187,7 +199,8 @@ namespace grapholon {
 		}
 
 
-		/** Adding is in O(1), removing in O(n) where n is the number of TRUE voxels*/
+		/** Adding is in O(1), removing in O(n) where n is the number of TRUE voxels.
+		Within a batch (see begin_batch()) both are in O(1)*/
 		bool set_voxel(GRuint id, bool value = true) {
 			if (
 				id >= nb_voxels_) {
@@ -201,10 +214,27 @@ namespace grapholon {
 			voxels_[id].value_ = value;
 			voxels_[id].topological_class_ = UNCLASSIFIED;
 
-			if (value) {
+			//an unset voxel is not an anchor anymore
+			if (!value && voxels_[id].anchor_) {
+				voxels_[id].anchor_ = false;
+				anchor_count_--;
+			}
+
+			if (batch_open_) {
+				if (!value) {
+					batch_removed_count_++;
+				}
+				else if (!voxels_[id].listed_) {
+					voxels_[id].listed_ = true;
+					batch_added_voxels_.push_back(id);
+				}
+			}
+			else if (value) {
+				voxels_[id].listed_ = true;
 				true_voxels_.push_back(id);
 			}
 			else {
+				voxels_[id].listed_ = false;
 				true_voxels_.erase(std::remove(true_voxels_.begin(), true_voxels_.end(), id), true_voxels_.end());
 			}
 
@@ -217,14 +247,17 @@ namespace grapholon {
 
 
 
+		/** Sets (or unsets) the voxel and flags it as an anchor (or not). Both in O(1)*/
 		bool set_anchor_voxel(GRuint id, bool value = true) {
+			if (id >= nb_voxels_) {
+				return false;
+			}
+
 			set_voxel(id, value);
 
-			if (value) {
-				anchor_voxels_.push_back(id);
-			}
-			else {
-				anchor_voxels_.erase(std::remove(anchor_voxels_.begin(), anchor_voxels_.end(), id), anchor_voxels_.end());
+			if (voxels_[id].anchor_ != value) {
+				voxels_[id].anchor_ = value;
+				anchor_count_ = value ? anchor_count_ + 1 : anchor_count_ - 1;
 			}
 
 			return true;
@@ -234,12 +267,137 @@ namespace grapholon {
 			return set_anchor_voxel(voxel_coordinates_to_id(x,y,z), value);
 		}
 
+		/** Bulk version of set_anchor_voxel(), e.g. to import landmarks. The voxels are set in a single batch (see commit_batch())*/
+		void set_anchor_voxels(const IndexVector& voxel_ids, bool value = true) {
+			bool batch_was_open = batch_open_;
+			batch_open_ = true;
+			for (auto voxel_id : voxel_ids) {
+				set_anchor_voxel(voxel_id, value);
+			}
+			if (!batch_was_open) {
+				commit_batch();
+			}
+		}
+
+		GRuint anchor_count() const {
+			return anchor_count_;
+		}
+
+		/** Lists the anchors (this is in O(n) where n is the number of TRUE voxels)*/
+		IndexVector anchor_voxels() const {
+			IndexVector anchors;
+			anchors.reserve(anchor_count_);
+			for (auto voxel_id : true_voxels_) {
+				if (voxels_[voxel_id].anchor_) {
+					anchors.push_back(voxel_id);
+				}
+			}
+			return anchors;
+		}
+
 
-		/** sets the whole memory to zero and empties the list of true voxels*/
+		/** sets the whole memory to zero and empties the list of true voxels (keeping its capacity)*/
 		void remove_all_voxels() {
 			memset(voxels_, 0, nb_voxels_ * sizeof(Voxel));
-			true_voxels_ = std::vector<GRuint>();
-			anchor_voxels_ = std::vector<GRuint>();
+			true_voxels_.clear();
+			anchor_count_ = 0;
+			batch_added_voxels_.clear();
+			batch_removed_count_ = 0;
+		}
+
+
+		/** Starts a batch of modifications : until commit_batch() is called, set_voxel() only writes the grid
+		and true_voxels() is not up to date. Useful when setting or unsetting many voxels*/
+		void begin_batch() {
+			batch_open_ = true;
+		}
+
+		/** Applies the modifications made since begin_batch() to true_voxels_ in a single pass.
+		The voxels still set keep their order, the new ones are appended in the order they were set.
+		The removal pass is split between thread_count threads (0 to use all the hardware threads)*/
+		void commit_batch(GRuint thread_count = 1) {
+			batch_open_ = false;
+
+			if (batch_removed_count_) {
+				if (!thread_count) {
+					thread_count = hardware_thread_count();
+				}
+				std::vector<IndexVector> chunk_voxels(thread_count);
+				parallel_for_chunks(0, (GRuint)true_voxels_.size(), [&](GRuint begin, GRuint end, GRuint chunk_index) {
+					IndexVector& kept_voxels = chunk_voxels[chunk_index];
+					for (GRuint i(begin); i < end; i++) {
+						GRuint voxel_id = true_voxels_[i];
+						if (voxels_[voxel_id].value_) {
+							kept_voxels.push_back(voxel_id);
+						}
+						else {
+							voxels_[voxel_id].listed_ = false;
+						}
+					}
+				}, thread_count);
+
+				true_voxels_.clear();
+				for (auto& kept_voxels : chunk_voxels) {
+					true_voxels_.insert(true_voxels_.end(), kept_voxels.begin(), kept_voxels.end());
+				}
+			}
+
+			true_voxels_.reserve(true_voxels_.size() + batch_added_voxels_.size());
+			for (auto voxel_id : batch_added_voxels_) {
+				if (voxels_[voxel_id].value_) {
+					true_voxels_.push_back(voxel_id);
+				}
+				else {
+					voxels_[voxel_id].listed_ = false;
+				}
+			}
+
+			batch_added_voxels_.clear();
+			batch_removed_count_ = 0;
+		}
+
+		/** Sets (or unsets) all the given voxels at once. See commit_batch()*/
+		void set_voxels(const IndexVector& voxel_ids, bool value = true, GRuint thread_count = 1) {
+			bool batch_was_open = batch_open_;
+			batch_open_ = true;
+			for (auto voxel_id : voxel_ids) {
+				set_voxel(voxel_id, value);
+			}
+			if (!batch_was_open) {
+				commit_batch(thread_count);
+			}
+		}
+
+		/** Replaces the set voxels with the given ones (in that order, ignoring duplicates).
+		Unlike remove_all_voxels(), only the previously set voxels are cleared. The anchors that are in the new set
+		stay anchors, the others are dropped*/
+		void replace_voxels(const IndexVector& voxel_ids) {
+			IndexVector previous_voxels;
+			previous_voxels.swap(true_voxels_);
+			previous_voxels.insert(previous_voxels.end(), batch_added_voxels_.begin(), batch_added_voxels_.end());
+			batch_added_voxels_.clear();
+			batch_removed_count_ = 0;
+
+			for (auto voxel_id : previous_voxels) {
+				bool anchor = voxels_[voxel_id].anchor_;
+				voxels_[voxel_id] = Voxel(false, false, UNCLASSIFIED);
+				voxels_[voxel_id].anchor_ = anchor;
+			}
+
+			for (auto voxel_id : voxel_ids) {
+				if (voxel_id < nb_voxels_ && !voxels_[voxel_id].value_) {
+					voxels_[voxel_id].value_ = true;
+					voxels_[voxel_id].listed_ = true;
+					true_voxels_.push_back(voxel_id);
+				}
+			}
+
+			for (auto voxel_id : previous_voxels) {
+				if (!voxels_[voxel_id].value_ && voxels_[voxel_id].anchor_) {
+					voxels_[voxel_id].anchor_ = false;
+					anchor_count_--;
+				}
+			}
 		}
 
 		/***********************************************************************************************/
@@ -612,7 +770,7 @@ namespace grapholon {
 				break;
 			}
 			default: {
-				std::cerr << k << "-connectedness does not make sense with voxels. Returning false" << std::endl;
+				GR_LOG_WARNING(k << "-connectedness does not make sense with voxels. Returning false");
 				return false;
 			}
 			}
@@ -624,11 +782,7 @@ namespace grapholon {
 
 		/** See the definition of reducibility in litterature*/
 		bool is_reducible(std::vector<GRuint> voxels_id) {
-			std::cout << "checking if voxel set is reducible : " << std::endl;
-			for (GRuint i(0); i < voxels_id.size(); i++) {
-				std::cout << " - " << voxels_id[i] << " ";
-			}
-			std::cout << std::endl;
+			GR_LOG_DEBUG("checking if voxel set of size " << voxels_id.size() << " is reducible");
 
 			if (voxels_id.size() == 0) {
 				return false;
@@ -639,7 +793,7 @@ namespace grapholon {
 				bool x_exists_st_N0x_is_reducible_and_X_without_x_is_reducible = false;
 
 				for (GRuint i(0); i < voxels_id.size(); i++) {
-					std::cout << "	checking voxel " << voxels_id[i] << std::endl;
+					GR_LOG_DEBUG("	checking voxel " << voxels_id[i]);
 
 					//first computing N0(x)
 					std::vector<GRuint> neighbors;
@@ -661,15 +815,14 @@ namespace grapholon {
 					bool voxel_set_without_i_is_reducible = is_reducible(voxel_set_without_i);
 
 				
-					std::cout << "    neigh of voxel " << voxels_id[i] << " is "<<(neighborhood_is_reducible ? "" : " not ")<<" reducible " << std::endl;
-					std::cout << "    set without voxel " << voxels_id[i] << " is " << (voxel_set_without_i_is_reducible ? "" : " not ") << " reducible " << std::endl;
+					GR_LOG_DEBUG("    neigh of voxel " << voxels_id[i] << " is "<<(neighborhood_is_reducible ? "" : " not ")<<" reducible ");
+					GR_LOG_DEBUG("    set without voxel " << voxels_id[i] << " is " << (voxel_set_without_i_is_reducible ? "" : " not ") << " reducible ");
 
 
 					x_exists_st_N0x_is_reducible_and_X_without_x_is_reducible
 						|= (neighborhood_is_reducible && voxel_set_without_i_is_reducible);
 					
 				}
-				std::cout << std::endl << std::endl;
 				return x_exists_st_N0x_is_reducible_and_X_without_x_is_reducible;
 			}
 		}
@@ -726,7 +879,7 @@ namespace grapholon {
 		bool clique_matches_K2_mask(const GRuint x, const GRuint y, const GRuint z, const AXIS axis) {
 
 			if (axis > Z_AXIS) {
-				std::cerr << "wrong axis to apply K2 mask. Returning false" << std::endl;
+				GR_LOG_WARNING("wrong axis to apply K2 mask. Returning false");
 				return false;
 			}
 
@@ -770,7 +923,7 @@ namespace grapholon {
 							break;
 						}
 						default: {//the default shouldn't be necessary but you never know...
-							std::cerr << "wrong axis to apply K2 mask. Returning false" << std::endl;
+							GR_LOG_WARNING("wrong axis to apply K2 mask. Returning false");
 							return false;
 						}
 						}
@@ -975,7 +1128,7 @@ namespace grapholon {
 		GRuint extract_neighborhood_mask_value_on_axis(GRuint x, GRuint y, GRuint z, GRuint axis) {
 
 			if (axis > 2) {
-				std::cerr << " ERROR - axis should be in {0,1,2}. Returning NON_EXISTENT_ID " << std::endl;
+				GR_LOG_ERROR(" ERROR - axis should be in {0,1,2}. Returning NON_EXISTENT_ID ");
 				return NON_EXISTENT_ID;
 			}
 
@@ -1290,7 +1443,7 @@ namespace grapholon {
 				}
 			}
 
-			std::cout << " among " << K2Y_CONFIGURATIONS << " possible configurations, " << critical_masks_count << " were critical 2-cliques : " << std::endl;
+			GR_LOG_INFO(" among " << K2Y_CONFIGURATIONS << " possible configurations, " << critical_masks_count << " were critical 2-cliques");
 		}
 
 
@@ -1372,7 +1525,7 @@ namespace grapholon {
 		}
 
 		bool AnchoredSkel(GRuint voxel_id) {
-			return std::find(anchor_voxels_.begin(), anchor_voxels_.end(), voxel_id) != anchor_voxels_.end();
+			return voxels_[voxel_id].anchor_;
 		}
 
 		/** Standard Skel function as described by Couprie et al.*/
@@ -1380,6 +1533,11 @@ namespace grapholon {
 			return is_1_isthmus(voxel_id);
 		}
 
+		/** Keeps both the anchors and the 1-isthmuses (see PyramidThinning)*/
+		bool AnchoredOneIsthmusSkel(GRuint voxel_id) {
+			return AnchoredSkel(voxel_id) || is_1_isthmus(voxel_id);
+		}
+
 		/***************************************************************************** THINNING ALGOS **/
 
 		/** Skeletonizes the voxel complex */
@@ -1463,12 +1621,8 @@ namespace grapholon {
 				}
 				else {
 
-					//replace the previous voxel_set
-					remove_all_voxels();
-					//std::cout << "	removed all voxels, size : "<<true_voxels_.size() << std::endl;
-					for (GRuint i(0); i < voxel_set_Y.size(); i++) {
-						set_voxel(voxel_set_Y[i]);
-					}
+					//replace the previous voxel_set (this also un-selects every voxel)
+					replace_voxels(voxel_set_Y);
 					GRuint removed_count = voxel_count_at_iteration_start - (GRuint)true_voxels_.size();
 					//std::cout << "	and replaced them with Y" << std::endl;
 
@@ -1502,46 +1656,282 @@ namespace grapholon {
 		
 		
 		
+		/** Coarse-to-fine thinning for large complexes. The complex is downsampled 'levels' times by 2 (see downsample()),
+		the coarsest one is thinned with AsymmetricThinning and each finer level is then
+		 - restricted to the voxels within band_width of the (upsampled) coarser skeleton
+		 - anchored with one voxel per voxel of the coarser skeleton (the most surrounded set voxel of its block)
+		 - thinned with AsymmetricThinning
+		The work at each level is thus bounded by the size of the band rather than the size of the complex.
+		Use AnchoredSkel or AnchoredOneIsthmusSkel as Skel to keep the finer skeletons along the coarser ones.
+		NOTE : the band may cut thin features away from the coarse skeleton, use a larger band_width for noisy complexes*/
+		void PyramidThinning(SelectionFunction Select, SkelFunction Skel, GRuint levels = 1, GRuint band_width = 2) {
+			//a complex of a single voxel can't get any coarser
+			if (!levels || set_voxel_count() == 0 || MAX(MAX(width_, height_), slice_) <= 3) {
+				AsymmetricThinning(Select, Skel);
+				return;
+			}
+
+			VoxelComplex* coarse_skeleton = downsample(2);
+			coarse_skeleton->PyramidThinning(Select, Skel, levels - 1, band_width);
+			restrict_to_band(*coarse_skeleton, band_width);
+			delete coarse_skeleton;
+
+			AsymmetricThinning(Select, Skel);
+		}
+
+		/** Returns a quick preview : the skeleton of the complex downsampled by 2^levels (i.e. the coarsest level of PyramidThinning).
+		Its voxel (x, y, z) covers the voxels [x * 2^levels, (x+1) * 2^levels) (and so on) of this complex.
+		The factor stops growing once it covers the whole complex, so any number of levels is valid*/
+		VoxelComplex* PreviewSkeleton(SelectionFunction Select, SkelFunction Skel, GRuint levels = 1) {
+			GRuint largest_dimension = MAX(MAX(width_, height_), slice_) - 2;
+			GRuint factor(1);
+			for (GRuint level(0); level < levels && factor < largest_dimension; level++) {
+				factor *= 2;
+			}
+
+			VoxelComplex* coarse_skeleton = downsample(factor);
+			coarse_skeleton->AsymmetricThinning(Select, Skel);
+			return coarse_skeleton;
+		}
+
+	private:
+		/** Keeps only the voxels within band_width of the voxels of the coarse skeleton (whose voxels cover 2x2x2 blocks of this complex)
+		and anchors, for each voxel of the coarse skeleton, the set voxel of its block with the most set 0-neighbors (i.e. the most central one)*/
+		void restrict_to_band(const VoxelComplex& coarse_skeleton, GRuint band_width) {
+			IndexVector band_voxels;
+			band_voxels.reserve(true_voxels_.size());
+
+			const GRuint no_anchor = std::numeric_limits<GRuint>::max();
+			std::vector<GRuint> block_anchors(coarse_skeleton.voxel_count(), no_anchor);
+			std::vector<GRuint> block_anchor_neighbor_counts(coarse_skeleton.voxel_count(), 0);
+
+			GRuint x, y, z;
+			for (auto voxel_id : true_voxels_) {
+				voxel_id_to_coordinates(voxel_id, x, y, z);
+				if (x >= width_ - 2 || y >= height_ - 2 || z >= slice_ - 2) {
+					continue;
+				}
+
+				//the coarse voxels whose block is within band_width of this voxel
+				bool in_band(false);
+				GRuint first[3] = { (x - MIN(x, band_width)) / 2, (y - MIN(y, band_width)) / 2, (z - MIN(z, band_width)) / 2 };
+				GRuint last[3] = { (x + band_width) / 2, (y + band_width) / 2, (z + band_width) / 2 };
+				for (GRuint k(first[2]); k <= last[2] && !in_band; k++) {
+					for (GRuint j(first[1]); j <= last[1] && !in_band; j++) {
+						for (GRuint i(first[0]); i <= last[0] && !in_band; i++) {
+							in_band = i < coarse_skeleton.width() - 2
+								&& j < coarse_skeleton.height() - 2
+								&& k < coarse_skeleton.slice() - 2
+								&& coarse_skeleton.voxel(coarse_skeleton.voxel_coordinates_to_id(i, j, k)).value_;
+						}
+					}
+				}
+				if (!in_band) {
+					continue;
+				}
+				band_voxels.push_back(voxel_id);
+
+				GRuint block_id = coarse_skeleton.voxel_coordinates_to_id(x / 2, y / 2, z / 2);
+				if (coarse_skeleton.voxel(block_id).value_) {
+					IndexVector neighborhood;
+					extract_0_neighborhood_star(x, y, z, neighborhood);
+					GRuint neighbor_count = (GRuint)neighborhood.size() + 1;
+					if (neighbor_count > block_anchor_neighbor_counts[block_id]) {
+						block_anchors[block_id] = voxel_id;
+						block_anchor_neighbor_counts[block_id] = neighbor_count;
+					}
+				}
+			}
+
+			replace_voxels(band_voxels);
+
+			for (auto voxel_id : block_anchors) {
+				if (voxel_id != no_anchor) {
+					set_anchor_voxel(voxel_id);
+				}
+			}
+		}
+
+	public:
+
+		
+		
+		
 		/***********************************************************************************************/
 		/******************************************************************* SKELETON-WISE OPERATIONS **/
 		/***********************************************************************************************/
 
-		/** This subdivision creates a copy of this VoxelComplex and then subdivides each voxel in either 8 (subdivision_level = 2) or 27 (sub level = 3)*/
-		VoxelComplex* subdivide(GRuint subdivision_level) {
-			if (subdivision_level > 3) {
-				std::cerr << " subdividing in more that 3 is too risky performance-wise. returning nullptr" << std::endl;
+		/** This subdivision creates a copy of this VoxelComplex and then subdivides each voxel in either 8 (subdivision_level = 2) or 27 (sub level = 3), etc.*/
+		VoxelComplex* subdivide(GRuint subdivision_level, GRuint thread_count = 1) {
+			return subdivide(subdivision_level, subdivision_level, subdivision_level, thread_count);
+		}
+
+		/** Subdivides each voxel in factor_x * factor_y * factor_z voxels of a new complex.
+		The subdivided blocks are written row by row directly in the new grid, in parallel over Z
+		(thread_count = 0 to use all the hardware threads). The true voxels of the result are sorted by id.
+		Returns nullptr if a factor is 0 or if the result would be too large to be indexed*/
+		VoxelComplex* subdivide(GRuint factor_x, GRuint factor_y, GRuint factor_z, GRuint thread_count = 1) {
+			if (!subdivision_fits(factor_x, factor_y, factor_z)) {
 				return nullptr;
 			}
 
 			VoxelComplex* subdivided_skeleton = new VoxelComplex(
-				width_*subdivision_level,
-				height_*subdivision_level,
-				slice_*subdivision_level);
+				width_*factor_x,
+				height_*factor_y,
+				slice_*factor_z);
+
+			if (!thread_count) {
+				thread_count = hardware_thread_count();
+			}
+
+			//the voxels set in the upper padding are subdivided too, there is room for them in the new complex
+			GRuint source_width = width_ - 1;
+			GRuint source_height = height_ - 1;
+			size_t row_size = subdivided_skeleton->width_ * sizeof(Voxel);
+			size_t slice_size = (size_t)subdivided_skeleton->height_ * row_size;
+
+			//each chunk of slices lists its voxels in order, so that the concatenation is sorted
+			std::vector<IndexVector> chunk_voxels(thread_count);
+			parallel_for_chunks(0, slice_ - 1, [&](GRuint first_slice, GRuint end_slice, GRuint chunk_index) {
+				IndexVector& voxel_ids = chunk_voxels[chunk_index];
+				IndexVector set_columns;///< the x of the set voxels of each source row of the slice
+				IndexVector row_ends;///< where the columns of each source row end in set_columns
+
+				for (GRuint z(first_slice); z < end_slice; z++) {
+					set_columns.clear();
+					row_ends.clear();
+
+					//the first output slice of the block : expand each source row once and copy it to the other rows of its block
+					for (GRuint y(0); y < source_height; y++) {
+						const Voxel* source_row = voxels_ + voxel_coordinates_to_id(0, y, z);
+						Voxel* output_row = subdivided_skeleton->voxels_ + subdivided_skeleton->voxel_coordinates_to_id(0, y * factor_y, z * factor_z);
+						GRuint row_begin = (GRuint)set_columns.size();
+						for (GRuint x(0); x < source_width; x++) {
+							if (source_row[x].value_) {
+								set_columns.push_back(x);
+								for (GRuint i(0); i < factor_x; i++) {
+									output_row[x * factor_x + i].value_ = true;
+									output_row[x * factor_x + i].listed_ = true;
+								}
+							}
+						}
+						row_ends.push_back((GRuint)set_columns.size());
+						if (row_begin != set_columns.size()) {
+							for (GRuint j(1); j < factor_y; j++) {
+								memcpy((char*)(output_row - 1) + j * row_size, output_row - 1, row_size);
+							}
+						}
+					}
+					if (!set_columns.size()) {
+						continue;
+					}
 
-			GRuint x, y, z;
-			for (auto voxel_id : true_voxels_) {
-				voxel_id_to_coordinates(voxel_id, x, y, z);
+					//then copy that whole slice to the other slices of the block
+					Voxel* first_output_slice = subdivided_skeleton->voxels_ + (size_t)(z * factor_z + 1) * subdivided_skeleton->width_ * subdivided_skeleton->height_;
+					for (GRuint k(1); k < factor_z; k++) {
+						memcpy((char*)first_output_slice + k * slice_size, first_output_slice, slice_size);
+					}
 
-				for (GRuint i(0); i < subdivision_level; i++) {
-					for (GRuint j(0); j < subdivision_level; j++) {
-						for (GRuint k(0); k < subdivision_level; k++) {
-							subdivided_skeleton->set_voxel(
-								subdivision_level * x + i,
-								subdivision_level * y + j,
-								subdivision_level * z + k);
+					//and list the new voxels in id order
+					for (GRuint k(0); k < factor_z; k++) {
+						for (GRuint y(0); y < source_height; y++) {
+							GRuint row_begin = y ? row_ends[y - 1] : 0;
+							if (row_begin == row_ends[y]) {
+								continue;
+							}
+							for (GRuint j(0); j < factor_y; j++) {
+								GRuint first_id = subdivided_skeleton->voxel_coordinates_to_id(0, y * factor_y + j, z * factor_z + k);
+								for (GRuint c(row_begin); c < row_ends[y]; c++) {
+									for (GRuint i(0); i < factor_x; i++) {
+										voxel_ids.push_back(first_id + set_columns[c] * factor_x + i);
+									}
+								}
+							}
 						}
 					}
 				}
+			}, thread_count);
+
+			size_t total_count(0);
+			for (auto& voxel_ids : chunk_voxels) {
+				total_count += voxel_ids.size();
+			}
+			subdivided_skeleton->true_voxels_.reserve(total_count);
+			for (auto& voxel_ids : chunk_voxels) {
+				subdivided_skeleton->true_voxels_.insert(subdivided_skeleton->true_voxels_.end(), voxel_ids.begin(), voxel_ids.end());
 			}
 
 			return subdivided_skeleton;
 		}
 
+		/** (z, values) with values the (width()*factor_x) * (height()*factor_y) voxels of slice z, x varying fastest (1 if set, 0 otherwise)*/
+		typedef std::function<void(GRuint, const GRuchar*)> SliceCallback;
+
+		/** Same as subdivide() but the subdivided complex is never built : each slice of its (unpadded) grid is handed to
+		the callback in order, in the format expected by load_volume(). Only one slice is in memory at a time.
+		Returns false if a factor is 0 or if the result would be too large to be indexed*/
+		bool subdivide_streaming(GRuint factor_x, GRuint factor_y, GRuint factor_z, SliceCallback callback) const {
+			if (!subdivision_fits(factor_x, factor_y, factor_z)) {
+				return false;
+			}
+
+			GRuint output_width = width_ * factor_x;
+			GRuint output_height = height_ * factor_y;
+			GRuint output_slice = slice_ * factor_z;
+			std::vector<GRuchar> values((size_t)output_width * output_height);
+
+			GRuint output_z(0);
+			for (GRuint z(0); z < slice_ - 1; z++) {
+				std::fill(values.begin(), values.end(), (GRuchar)0);
+				for (GRuint y(0); y < height_ - 1; y++) {
+					const Voxel* source_row = voxels_ + voxel_coordinates_to_id(0, y, z);
+					GRuchar* output_row = values.data() + (size_t)y * factor_y * output_width;
+					bool row_is_empty(true);
+					for (GRuint x(0); x < width_ - 1; x++) {
+						if (source_row[x].value_) {
+							row_is_empty = false;
+							std::fill(output_row + x * factor_x, output_row + (x + 1) * factor_x, (GRuchar)1);
+						}
+					}
+					if (!row_is_empty) {
+						for (GRuint j(1); j < factor_y; j++) {
+							std::copy(output_row, output_row + output_width, output_row + j * output_width);
+						}
+					}
+				}
+				for (GRuint k(0); k < factor_z; k++) {
+					callback(output_z++, values.data());
+				}
+			}
+
+			//the remaining slices are empty
+			std::fill(values.begin(), values.end(), (GRuchar)0);
+			while (output_z < output_slice) {
+				callback(output_z++, values.data());
+			}
+
+			return true;
+		}
+
 		/** The smooth subdivision does the same as the subdivision except it adds some voxel in 'creases' to make the result smoother*/
-		VoxelComplex* subdivide_smooth() {
-			VoxelComplex* subdivided_skeleton = this->subdivide(2);
+		VoxelComplex* subdivide_smooth(GRuint thread_count = 1) {
+			VoxelComplex* subdivided_skeleton = this->subdivide(2, thread_count);
+			if (subdivided_skeleton == nullptr) {
+				return nullptr;
+			}
 
-			std::vector<GRuint> voxels_to_add;
+			//the selected_ flag marks the voxels already listed, so that each is listed once
+			IndexVector voxels_to_add;
+			auto add_voxel = [&](GRuint voxel_id) {
+				if (voxel_id >= subdivided_skeleton->nb_voxels_) {
+					return;
+				}
+				Voxel& voxel = subdivided_skeleton->voxels_[voxel_id];
+				if (!voxel.value_ && !voxel.selected_) {
+					voxel.selected_ = true;
+					voxels_to_add.push_back(voxel_id);
+				}
+			};
 
 			//look for all pairs of voxels that are not 2-connected in every direction
 			for (auto voxel_id : subdivided_skeleton->true_voxels_) {
@@ -1553,13 +1943,13 @@ namespace grapholon {
 					|| subdivided_skeleton->voxel(x - 1, y, z - 1).value_
 					|| subdivided_skeleton->voxel(x, y + 1, z - 1).value_
 					|| subdivided_skeleton->voxel(x, y - 1, z - 1).value_) {
-					voxels_to_add.push_back(subdivided_skeleton->voxel_coordinates_to_id(x, y, z - 1));
+					add_voxel(subdivided_skeleton->voxel_coordinates_to_id(x, y, z - 1));
 				}
 				if (subdivided_skeleton->voxel(x + 1, y, z + 1).value_
 					|| subdivided_skeleton->voxel(x - 1, y, z + 1).value_
 					|| subdivided_skeleton->voxel(x, y + 1, z + 1).value_
 					|| subdivided_skeleton->voxel(x, y - 1, z + 1).value_) {
-					voxels_to_add.push_back(subdivided_skeleton->voxel_coordinates_to_id(x, y, z + 1));
+					add_voxel(subdivided_skeleton->voxel_coordinates_to_id(x, y, z + 1));
 				}
 
 				//and the 0-neighborhood
@@ -1567,9 +1957,9 @@ namespace grapholon {
 					for (GRuint j(0); j < 2; j++) {
 						for (GRuint k(0); k < 2; k++) {
 							if (subdivided_skeleton->voxel(x - 1 + i*2, y - 1 + j*2, z -1 + k*2).value_) {
-								voxels_to_add.push_back(subdivided_skeleton->voxel_coordinates_to_id(x, y, z - 1 + k * 2));
-								voxels_to_add.push_back(subdivided_skeleton->voxel_coordinates_to_id(x - 1 + i * 2, y, z - 1 + k * 2));
-								voxels_to_add.push_back(subdivided_skeleton->voxel_coordinates_to_id(x, y - 1 + j * 2, z - 1 + k * 2));
+								add_voxel(subdivided_skeleton->voxel_coordinates_to_id(x, y, z - 1 + k * 2));
+								add_voxel(subdivided_skeleton->voxel_coordinates_to_id(x - 1 + i * 2, y, z - 1 + k * 2));
+								add_voxel(subdivided_skeleton->voxel_coordinates_to_id(x, y - 1 + j * 2, z - 1 + k * 2));
 							}
 						}
 					}
@@ -1578,17 +1968,47 @@ namespace grapholon {
 
 			//and then add all the listed voxels
 			for (auto voxel_id : voxels_to_add) {
-				subdivided_skeleton->set_voxel(voxel_id);
+				subdivided_skeleton->voxels_[voxel_id].selected_ = false;
 			}
+			subdivided_skeleton->set_voxels(voxels_to_add);
 
 			return subdivided_skeleton;
 		}
 
+		/** The inverse of subdivide() : each block of factor * factor * factor voxels becomes a single voxel,
+		which is set if any voxel of the block is set. This keeps the complex connected*/
+		VoxelComplex* downsample(GRuint factor) {
+			if (!factor) {
+				GR_LOG_WARNING("downsampling factor must be at least 1. returning nullptr");
+				return nullptr;
+			}
+
+			VoxelComplex* downsampled_skeleton = new VoxelComplex(
+				(width_ - 2 + factor - 1) / factor,
+				(height_ - 2 + factor - 1) / factor,
+				(slice_ - 2 + factor - 1) / factor);
+
+			GRuint x, y, z;
+			downsampled_skeleton->begin_batch();
+			for (auto voxel_id : true_voxels_) {
+				voxel_id_to_coordinates(voxel_id, x, y, z);
+				if (x < width_ - 2 && y < height_ - 2 && z < slice_ - 2) {
+					downsampled_skeleton->set_voxel(x / factor, y / factor, z / factor);
+				}
+			}
+			downsampled_skeleton->commit_batch();
+
+			return downsampled_skeleton;
+		}
+
 		/* Smoothind of the 0-connected max_distance neighborhood.
-		0.5 threshold means that half of the neighborhood must be set. i.e. each voxel will take the value of the majority over its neighbors**/
+		0.5 threshold means that half of the neighborhood must be set. i.e. each voxel will take the value of the majority over its neighbors.
+		Only the voxels within max_distance of the border (set voxels with an unset 0-neighbor) can change.
+		The neighbor counts are computed with separable running sums over the bounding box of the set voxels,
+		so the cost per voxel does not depend on max_distance**/
 		VoxelComplex* smooth_moving_average(GRuint max_distance, GRfloat threshold = 0.5f) {
-			if (max_distance > 2) {
-				throw std::invalid_argument("You are trying to smooth over a distance greater than 2. That means smoothing over at least 125 voxels. This is not allowed");
+			if (max_distance > MAX_SMOOTHING_DISTANCE) {
+				throw std::invalid_argument("You are trying to smooth over a distance greater than the maximum smoothing distance");
 			}
 			if (threshold < MIN_SMOOTHING_THRESHOLD) {
 				throw std::invalid_argument("You are trying to smooth with a threshold lower than the minimum threshold");
@@ -1597,81 +2017,74 @@ namespace grapholon {
 				throw std::invalid_argument("You are trying to smooth with a threshold greater than 1");
 			}
 
-			IndexVector to_set;
-			IndexVector to_unset;
-
-			std::vector<bool> in_to_check(voxel_count());
-
-			IndexVector to_check;
-
 			VoxelComplex* smoothed_skeleton = copy();
 
-			GRuint count(0);
+			if (!true_voxels_.size()) {
+				return smoothed_skeleton;
+			}
 
-			//first establish the list of voxels to treat. 
-			//That is, the border voxels and their neighborhood
-			//we also set all the current true voxels to save the trouble of checking the interior voxels
+			//the region to work on : the bounding box of the set voxels grown by max_distance. Everything else stays empty
+			GRuint inner_size[3] = { width_ - 2, height_ - 2, slice_ - 2 };
+			GRuint min_corner[3] = { inner_size[0], inner_size[1], inner_size[2] };
+			GRuint max_corner[3] = { 0, 0, 0 };
+			GRuint coords[3];
 			for (auto voxel_id : true_voxels_) {
-				GRuint x, y, z;
-				voxel_id_to_coordinates(voxel_id, x, y, z);
-
-				IndexVector neighborhood;
-				extract_0_neighborhood_star(voxel_id, neighborhood, true);
-
-				if (neighborhood.size()) {
-					smoothed_skeleton->set_voxel(voxel_id);
-					for (GRuint i(0); i <= max_distance * 2; i++) {
-						for (GRuint j(0); j <= max_distance * 2; j++) {
-							for (GRuint k(0); k <= max_distance * 2; k++) {
-								GRuint neighbor_id = voxel_coordinates_to_id(x - max_distance + i, y - max_distance + j, z - max_distance + k);
-
-								if (neighbor_id < voxel_count() && !in_to_check[neighbor_id]) {
-									in_to_check[neighbor_id] = true;
-									to_check.push_back(neighbor_id);
-								}
-							}
-						}
-					}
+				voxel_id_to_coordinates(voxel_id, coords[0], coords[1], coords[2]);
+				for (GRuint axis(0); axis < 3; axis++) {
+					min_corner[axis] = MIN(min_corner[axis], coords[axis]);
+					max_corner[axis] = MAX(max_corner[axis], coords[axis]);
 				}
 			}
+			GRuint region_size[3];
+			for (GRuint axis(0); axis < 3; axis++) {
+				min_corner[axis] -= MIN(min_corner[axis], max_distance);
+				max_corner[axis] = MIN(max_corner[axis] + max_distance, inner_size[axis] - 1);
+				region_size[axis] = max_corner[axis] - min_corner[axis] + 1;
+			}
+			size_t region_count = (size_t)region_size[0] * region_size[1] * region_size[2];
+			auto region_index = [&](GRuint x, GRuint y, GRuint z) {
+				return x - min_corner[0] + region_size[0] * ((size_t)y - min_corner[1] + region_size[1] * ((size_t)z - min_corner[2]));
+			};
 
-			//std::cout << "voxels to check : " << to_check.size() << std::endl;
+			//scratch memory : 6 bytes per voxel of the region (two byte flags, the counts and the box sums' temporary)
+			SmoothingFlags values(region_count, 0);
+			for (auto voxel_id : true_voxels_) {
+				voxel_id_to_coordinates(voxel_id, coords[0], coords[1], coords[2]);
+				values[region_index(coords[0], coords[1], coords[2])] = 1;
+			}
+			SmoothingCounts counts(region_count);
+			SmoothingCounts temporary(region_count);
 
-			for (auto voxel_id : to_check){
-				GRuint x, y, z;
-				voxel_id_to_coordinates(voxel_id, x, y, z);
+			//border voxels have less than 27 set voxels in their 3x3x3 box
+			box_sum(values.data(), region_size, 1, counts.data(), temporary.data());
+			SmoothingFlags border(region_count);
+			for (size_t i(0); i < region_count; i++) {
+				border[i] = values[i] && counts[i] < 27;
+			}
+
+			//the voxels to check are the ones with a border voxel in their neighborhood. The flags replace the border ones
+			box_sum(border.data(), region_size, max_distance, counts.data(), temporary.data());
+			SmoothingFlags& near_border = border;
+			for (size_t i(0); i < region_count; i++) {
+				near_border[i] = counts[i] != 0;
+			}
+			box_sum(values.data(), region_size, max_distance, counts.data(), temporary.data());
 
-				GRfloat average(0.f);
-				GRuint neighbors_count(0);
+			GRuint side = 2 * max_distance + 1;
+			GRfloat neighbors_count = (GRfloat)(side * side * side);
 
-				for (GRuint i(0); i <= max_distance*2; i++) {
-					for (GRuint j(0); j <= max_distance*2; j++) {
-						for (GRuint k(0); k <= max_distance*2; k++) {
-							average += voxel(x - max_distance + i, y - max_distance + j, z - max_distance + k).value_;
-							neighbors_count++;
+			smoothed_skeleton->begin_batch();
+			for (GRuint z(min_corner[2]); z <= max_corner[2]; z++) {
+				for (GRuint y(min_corner[1]); y <= max_corner[1]; y++) {
+					size_t i = region_index(min_corner[0], y, z);
+					for (GRuint x(min_corner[0]); x <= max_corner[0]; x++, i++) {
+						if (near_border[i]) {
+							smoothed_skeleton->set_voxel(x, y, z, (GRfloat)counts[i] / neighbors_count >= threshold);
 						}
 					}
 				}
-				count = neighbors_count;
-
-				average /= (GRfloat)neighbors_count;
-
-				if (average >= threshold) {
-					to_set.push_back(voxel_id);
-				}
-				else {
-					to_unset.push_back(voxel_id);
-				}
-			}
-
-			for (auto to_set_id : to_set) {
-				smoothed_skeleton->set_voxel(to_set_id, true);
-			}
-
-			for (auto to_unset_id : to_unset) {
-				smoothed_skeleton->set_voxel(to_unset_id, false);
 			}
-
+			smoothed_skeleton->commit_batch();
 
 			return smoothed_skeleton;
 		}
@@ -1705,11 +2118,13 @@ namespace grapholon {
 
 			VoxelComplex* fit_skeleton = new VoxelComplex(new_width, new_height, new_slice);
 
+			fit_skeleton->begin_batch();
 			for (auto voxel_id : true_voxels_) {
 				voxel_id_to_coordinates(voxel_id, x, y, z);
 
 				fit_skeleton->set_voxel(x - x_min, y - y_min, z - z_min);
 			}
+			fit_skeleton->commit_batch();
 
 			return fit_skeleton;
 		}
@@ -1718,9 +2133,7 @@ namespace grapholon {
 		/** returns an allocated copy of this skeleton*/
 		VoxelComplex* copy() {
 			VoxelComplex* skeleton_copy = new VoxelComplex(width_-2, height_-2, slice_-2);
-			for (auto voxel_id : true_voxels_) {
-				skeleton_copy->set_voxel(voxel_id);
-			}
+			skeleton_copy->set_voxels(true_voxels_);
 
 			return skeleton_copy;
 		}
@@ -1731,12 +2144,14 @@ namespace grapholon {
 		\param original_voxel_set the original complex can be used to estimate the radius of each vertex in the final graph
 		\param spline_extraction_method various methods exist to turn a series of voxels into a smooth curve. See the documentation of DiscreteCurve for more details
 		\param smoothing_window_width a parameter used to smooth the edges' curves
-		\param curve_fitting_max_error a parameter used by the DiscreteCurve::CURVE_FITTING method*/
+		\param curve_fitting_max_error a parameter used by the DiscreteCurve::CURVE_FITTING method
+		\param thread_count the edges' curves are smoothed and fitted on this many threads once they were all found*/
 		SkeletalGraph* extract_skeletal_graph(
 			VoxelComplex* original_voxel_set = nullptr,
 			DiscreteCurve::CONVERSION_METHOD spline_extraction_method = DiscreteCurve::CURVE_FITTING,
 			GRuint smoothing_window_width = 5,
-			GRfloat curve_fitting_max_error = 0.1f) {
+			GRfloat curve_fitting_max_error = 0.1f,
+			GRuint thread_count = 1) {
 
 			bool debug_log(false);
 
@@ -1753,7 +2168,7 @@ namespace grapholon {
 			SkeletalGraph* graph = new SkeletalGraph();
 
 			if (!set_voxel_count()) {
-				std::cerr << "Cannot extract graph from empty skeleton. Returning empty graph" << std::endl;
+				GR_LOG_WARNING("Cannot extract graph from empty skeleton. Returning empty graph");
 				return graph;
 			}
 
@@ -2010,11 +2425,9 @@ namespace grapholon {
 									//adding the target voxel's position to the edge's curve
 									discrete_edge_curve.push_back(Vector3f((GRfloat)x, (GRfloat)y, (GRfloat)z));
 
-									discrete_edge_curve.smooth_moving_average(smoothing_window_width);
-
-									EdgeProperties edge_properties({ *(discrete_edge_curve.to_spline_curve(spline_extraction_method, &curve_fitting_max_error)) });
-
-									graph->add_edge(vertices[start_id], vertices[current_id], edge_properties);
+									//the edge is added once all the curves are fitted
+									edges_source_targets.push_back({ vertices[start_id], vertices[current_id] });
+									edge_curves.push_back(std::move(discrete_edge_curve));
 
 									IF_DEBUG_DO(std::cout << "			voxel " << current_id << " (" << x << " " << y << " " << z << ") is a vertex " << std::endl;)
 									IF_DEBUG_DO(std::cout << "			added an edge from " << start_id << " to " << current_id << std::endl;)
@@ -2084,6 +2497,16 @@ namespace grapholon {
 				iteration_count++;
 			}
 
+			parallel_for(0, (GRuint)edge_curves.size(), [&](GRuint i) {
+				edge_curves[i].smooth_moving_average(smoothing_window_width);
+			}, thread_count);
+
+			std::vector<SplineCurve> edge_splines = DiscreteCurve::to_spline_curves(edge_curves, spline_extraction_method, curve_fitting_max_error, thread_count);
+
+			for (GRuint i(0); i < edge_splines.size(); i++) {
+				EdgeProperties edge_properties({ edge_splines[i] });
+				graph->add_edge(edges_source_targets[i].first, edges_source_targets[i].second, edge_properties);
+			}
 
 			return graph;
 		}
@@ -2091,6 +2514,216 @@ namespace grapholon {
 
 
 
+		/***********************************************************************************************/
+		/***************************************************************************** VOLUME LOADING **/
+		/***********************************************************************************************/
+
+		/** Replaces the content of this complex with an 8 bits volume of (width()-2) * (height()-2) * (slice()-2) values,
+		x varying fastest. The voxels whose value matches the selection are set.
+		Rows are compared in bulk, empty ones are skipped, and true_voxels_ is built in a single parallel sweep (sorted by id)*/
+		void load_volume(const GRuchar* data, VoxelSelection selection, GRuint thread_count = 1) {
+			GRuint row_width = width_ - 2;
+			load_volume_rows([data, selection, row_width](GRuint row, GRuchar* mask) {
+				const GRuchar* values = data + (size_t)row * row_width;
+				GRuint selected_count(0);
+				if (selection.mode == VoxelSelection::THRESHOLD) {
+					for (GRuint x(0); x < row_width; x++) {
+						mask[x] = values[x] >= selection.value;
+						selected_count += mask[x];
+					}
+				}
+				else {
+					for (GRuint x(0); x < row_width; x++) {
+						mask[x] = values[x] == selection.value;
+						selected_count += mask[x];
+					}
+				}
+				return selected_count;
+			}, thread_count);
+		}
+
+		/** Same as load_volume() for a 1 bit volume : 8 voxels per byte, least significant bit first, without padding between rows*/
+		void load_bit_volume(const GRuchar* data, GRuint thread_count = 1) {
+			GRuint row_width = width_ - 2;
+			load_volume_rows([data, row_width](GRuint row, GRuchar* mask) {
+				size_t bit = (size_t)row * row_width;
+				GRuint selected_count(0);
+				for (GRuint x(0); x < row_width; x++, bit++) {
+					mask[x] = (data[bit >> 3] >> (bit & 7)) & 1;
+					selected_count += mask[x];
+				}
+				return selected_count;
+			}, thread_count);
+		}
+
+		/** Creates a complex from the raw volume described by the header (see VolumeFile.hpp).
+		Throws a std::runtime_error if the data file can't be read or is too small*/
+		static VoxelComplex* load_raw_volume_file(const VolumeHeader& header,
+			VoxelSelection selection = VoxelSelection::threshold(1), GRuint thread_count = 1) {
+
+			MappedFile file;
+			if (!file.open(header.data_file)) {
+				throw std::runtime_error("ERROR - Could not open volume data file " + header.data_file);
+			}
+
+			size_t data_size = header.data_size();
+			size_t data_offset = header.data_offset < 0 ? file.size() - std::min(file.size(), data_size) : (size_t)header.data_offset;
+			if (data_offset > file.size() || file.size() - data_offset < data_size) {
+				throw std::runtime_error("ERROR - Volume data file is too small for the given dimensions");
+			}
+
+			VoxelComplex* complex = new VoxelComplex(header.width, header.height, header.slice);
+			const GRuchar* data = (const GRuchar*)file.data() + data_offset;
+			if (header.element_type == VOLUME_BIT) {
+				complex->load_bit_volume(data, thread_count);
+			}
+			else {
+				complex->load_volume(data, selection, thread_count);
+			}
+			return complex;
+		}
+
+		/** Creates a complex from a NRRD (.nrrd, .nhdr) or MetaImage (.mhd, .mha) 8 bits volume.
+		Throws a std::runtime_error if the file can't be read or is not supported (see read_volume_header())*/
+		static VoxelComplex* load_volume_file(const std::string& filename,
+			VoxelSelection selection = VoxelSelection::threshold(1), GRuint thread_count = 1) {
+			return load_raw_volume_file(read_volume_header(filename), selection, thread_count);
+		}
+
+	private:
+		/** select_row(row, mask) fills mask with 1 for each voxel of the row to set (0 otherwise) and returns how many there are.
+		Rows are numbered y + z * (height()-2) in the unpadded volume*/
+		template<typename RowSelector>
+		void load_volume_rows(RowSelector select_row, GRuint thread_count) {
+			true_voxels_.clear();
+			anchor_count_ = 0;
+			batch_added_voxels_.clear();
+			batch_removed_count_ = 0;
+
+			//only the padding is cleared here, each row is cleared by the sweep right before being filled
+			for (GRuint z(0); z < slice_; z++) {
+				for (GRuint y(0); y < height_; y++) {
+					if (z == 0 || z == slice_ - 1 || y == 0 || y == height_ - 1) {
+						memset(voxels_ + (y + z * height_) * width_, 0, width_ * sizeof(Voxel));
+					}
+				}
+			}
+
+			if (!thread_count) {
+				thread_count = hardware_thread_count();
+			}
+			GRuint row_width = width_ - 2;
+			GRuint row_height = height_ - 2;
+			GRuint row_count = row_height * (slice_ - 2);
+
+			//each chunk of rows collects its voxels in order, so that the concatenation is sorted
+			std::vector<IndexVector> chunk_voxels(thread_count);
+			parallel_for_chunks(0, row_count, [&](GRuint first_row, GRuint end_row, GRuint chunk_index) {
+				std::vector<GRuchar> mask(row_width);
+				IndexVector& voxel_ids = chunk_voxels[chunk_index];
+				for (GRuint row(first_row); row < end_row; row++) {
+					GRuint first_id = voxel_coordinates_to_id(0, row % row_height, row / row_height);
+					memset(voxels_ + first_id - 1, 0, width_ * sizeof(Voxel));
+					if (!select_row(row, mask.data())) {
+						continue;
+					}
+					for (GRuint x(0); x < row_width; x++) {
+						if (mask[x]) {
+							voxels_[first_id + x].value_ = true;
+							voxels_[first_id + x].listed_ = true;
+							voxel_ids.push_back(first_id + x);
+						}
+					}
+				}
+			}, thread_count);
+
+			size_t total_count(0);
+			for (auto& voxel_ids : chunk_voxels) {
+				total_count += voxel_ids.size();
+			}
+			true_voxels_.reserve(total_count);
+			for (auto& voxel_ids : chunk_voxels) {
+				true_voxels_.insert(true_voxels_.end(), voxel_ids.begin(), voxel_ids.end());
+			}
+		}
+
+		/** Checks that subdividing with these factors gives a complex whose voxels can be indexed with a GRuint*/
+		bool subdivision_fits(GRuint factor_x, GRuint factor_y, GRuint factor_z) const {
+			if (!factor_x || !factor_y || !factor_z) {
+				GR_LOG_WARNING("subdivision factors must be at least 1. returning nullptr");
+				return false;
+			}
+			unsigned long long subdivided_count = ((unsigned long long)width_ * factor_x + 2)
+				* ((unsigned long long)height_ * factor_y + 2)
+				* ((unsigned long long)slice_ * factor_z + 2);
+			if (subdivided_count > std::numeric_limits<GRuint>::max()) {
+				GR_LOG_WARNING("the subdivided complex would have too many voxels to be indexed. returning nullptr");
+				return false;
+			}
+			return true;
+		}
+
+		typedef std::vector<std::uint8_t> SmoothingFlags;
+		typedef std::vector<std::uint16_t> SmoothingCounts;
+
+		/** Running sum of 'radius' elements on each side along the middle dimension of a [outer][length][inner] array.
+		The inner dimension is contiguous, so whole rows (or slices) are added at once*/
+		template<typename Input>
+		static void box_sum_along_axis(const Input* input, std::uint16_t* output, size_t outer, size_t length, size_t inner, GRuint radius) {
+			for (size_t o(0); o < outer; o++) {
+				const Input* input_block = input + o * length * inner;
+				std::uint16_t* output_block = output + o * length * inner;
+
+				std::fill(output_block, output_block + inner, (std::uint16_t)0);
+				for (size_t k(0); k <= radius && k < length; k++) {
+					const Input* entering = input_block + k * inner;
+					for (size_t i(0); i < inner; i++) {
+						output_block[i] += entering[i];
+					}
+				}
+
+				for (size_t j(1); j < length; j++) {
+					std::uint16_t* row = output_block + j * inner;
+					const std::uint16_t* previous = row - inner;
+					const Input* entering = j + radius < length ? input_block + (j + radius) * inner : nullptr;
+					const Input* leaving = j > radius ? input_block + (j - radius - 1) * inner : nullptr;
+
+					if (entering && leaving) {
+						for (size_t i(0); i < inner; i++) {
+							row[i] = previous[i] + entering[i] - leaving[i];
+						}
+					}
+					else if (entering) {
+						for (size_t i(0); i < inner; i++) {
+							row[i] = previous[i] + entering[i];
+						}
+					}
+					else if (leaving) {
+						for (size_t i(0); i < inner; i++) {
+							row[i] = previous[i] - leaving[i];
+						}
+					}
+					else {
+						std::copy(previous, previous + inner, row);
+					}
+				}
+			}
+		}
+
+		/** output[i] = sum of the binary input over the (2*radius+1)^3 box centered on i, the outside of the region
+		counting as 0. The sums must fit in 16 bits (i.e. radius <= 19). output and temporary have the region's size*/
+		static void box_sum(const std::uint8_t* input, const GRuint size[3], GRuint radius, std::uint16_t* output, std::uint16_t* temporary) {
+			size_t row = size[0];
+			size_t slice = (size_t)size[0] * size[1];
+			box_sum_along_axis(input, output, (size_t)size[1] * size[2], size[0], 1, radius);
+			box_sum_along_axis(output, temporary, size[2], size[1], row, radius);
+			box_sum_along_axis(temporary, output, 1, size[2], slice, radius);
+		}
+
+	public:
+
+
+
 		/***********************************************************************************************/
 		/************************************************************************ SKELETON GENERATORS **/
 		/***********************************************************************************************/
@@ -2149,11 +2782,11 @@ namespace grapholon {
 			for (GRuint j(0); j < 5; j++) {
 				for (GRuint i(0); i < 5; i++) {
 					set_voxel(x++, y--, z++);
-					std::cout << "set voxel " << x << " " << y << " " << z << std::endl;
+					GR_LOG_DEBUG("set voxel " << x << " " << y << " " << z);
 				}
 				for (GRuint i(0); i < 5; i++) {
 					set_voxel(x++, y++, z--);
-					std::cout << "set voxel " << x << " " << y << " " << z << std::endl;
+					GR_LOG_DEBUG("set voxel " << x << " " << y << " " << z);
 				}
 
 				if (j == 3) {
@@ -2170,11 +2803,11 @@ namespace grapholon {
 			for (GRuint j(0); j < 5; j++) {
 				for (GRuint i(0); i < 5; i++) {
 					set_voxel(x--, y++, z++);
-					std::cout << "set voxel " << x << " " << y << " " << z << std::endl;
+					GR_LOG_DEBUG("set voxel " << x << " " << y << " " << z);
 				}
 				for (GRuint i(0); i < 5; i++) {
 					set_voxel(x++, y--, z++);
-					std::cout << "set voxel " << x << " " << y << " " << z << std::endl;
+					GR_LOG_DEBUG("set voxel " << x << " " << y << " " << z);
 				}
 			}
 
@@ -2388,7 +3021,7 @@ namespace grapholon {
 
 		void generate_artificial_simple_kissing(GRuint edges_length) {
 			if (width_ < 100 || height_ < 100) {
-				std::cerr << "can't generate that structure mate" << std::endl;
+				GR_LOG_ERROR("can't generate that structure mate");
 				exit(EXIT_FAILURE);
 			}
 			memset(voxels_, 0, nb_voxels_ * sizeof(Voxel));
@@ -7,6 +7,8 @@
 #include <sstream>
 #include <iostream>
 
+#include "Logger.hpp"
+
 #define MIN(x, y) (x < y ? x : y)
 #define MAX(x, y) (x > y ? x : y)
 
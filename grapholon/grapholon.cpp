@@ -1434,6 +1434,25 @@ void findCycleInSinusoidal() {
 }
 
 
+void fundamentalCycleBasis() {
+	VoxelComplex skeleton(100, 100, 100);
+	skeleton.generate_artificial_simple_kissing(10);
+
+	SkeletalGraph* graph = skeleton.extract_skeletal_graph(nullptr, DiscreteCurve::START_AND_END, 1, 0);
+
+	CycleBasis cycles = graph->fundamental_cycle_basis();
+
+	std::cout << "found " << cycles.size() << " independent cycles" << std::endl;
+	for (GRuint i(0); i < cycles.size(); i++) {
+		std::cout << " cycle " << i << " : " << std::endl;
+		for (auto edge : cycles[i]) {
+			std::cout << "   " << graph->get_edge_source(edge).position.to_string() << " -> " << graph->get_edge_target(edge).position.to_string() << std::endl;
+		}
+	}
+
+	delete graph;
+}
+
 void CutSimpleEdge() {
 
 	SkeletalGraph graph;
@@ -2034,6 +2053,95 @@ void remove_degree_2_vertices_stuff() {
 
 }
 
+/** Compares the vertices and edges of two graphs in their iteration order (positions, radii and curve points) and returns true if they are exactly the same*/
+bool sameGraphs(SkeletalGraph& graph1, SkeletalGraph& graph2) {
+	if (graph1.vertex_count() != graph2.vertex_count() || graph1.edge_count() != graph2.edge_count()) {
+		std::cout << "different sizes : " << graph1.vertex_count() << " vertices and " << graph1.edge_count() << " edges vs "
+			<< graph2.vertex_count() << " vertices and " << graph2.edge_count() << " edges" << std::endl;
+		return false;
+	}
+
+	auto vp1 = graph1.vertices();
+	auto vp2 = graph2.vertices();
+	for (; vp1.first != vp1.second; ++vp1.first, ++vp2.first) {
+		const VertexProperties& vertex1 = graph1.get_vertex(*vp1.first);
+		const VertexProperties& vertex2 = graph2.get_vertex(*vp2.first);
+		if (vertex1.position.squared_distance(vertex2.position) != 0 || vertex1.radius != vertex2.radius) {
+			std::cout << "different vertices : " << vertex1.position.to_string() << " vs " << vertex2.position.to_string() << std::endl;
+			return false;
+		}
+	}
+
+	auto ep1 = graph1.edges();
+	auto ep2 = graph2.edges();
+	for (; ep1.first != ep1.second; ++ep1.first, ++ep2.first) {
+		if (graph1.get_edge_source(*ep1.first).position.squared_distance(graph2.get_edge_source(*ep2.first).position) != 0
+			|| graph1.get_edge_target(*ep1.first).position.squared_distance(graph2.get_edge_target(*ep2.first).position) != 0) {
+			std::cout << "different edge ends" << std::endl;
+			return false;
+		}
+
+		const DeformableSplineCurve& curve1 = graph1.get_edge(*ep1.first).curve;
+		const DeformableSplineCurve& curve2 = graph2.get_edge(*ep2.first).curve;
+		if (curve1.size() != curve2.size()) {
+			std::cout << "different curve sizes : " << curve1.size() << " vs " << curve2.size() << std::endl;
+			return false;
+		}
+		for (GRuint i(0); i < curve1.size(); i++) {
+			if (curve1[i].first.squared_distance(curve2[i].first) != 0) {
+				std::cout << "different curve points : " << curve1[i].first.to_string() << " vs " << curve2[i].first.to_string() << std::endl;
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void binaryFileRoundTrip() {
+	SkeletalGraph* graph = new SkeletalGraph();
+	GRfloat scale;
+	SkeletalGraph::import_from_file("grapholon/test.graph", graph, scale);
+
+	std::string filename = "graph1.grb";
+	if (!graph->export_to_binary_file(filename, scale)) {
+		std::cout << "could not export the graph to " << filename << std::endl;
+		delete graph;
+		return;
+	}
+
+	SkeletalGraph* graph2 = new SkeletalGraph();
+	GRfloat scale2;
+	SkeletalGraph::import_from_binary_file(filename, graph2, scale2);
+
+	std::cout << "binary round trip : " << (sameGraphs(*graph, *graph2) && scale == scale2 ? "same graphs" : "DIFFERENT GRAPHS") << std::endl;
+
+	delete graph;
+	delete graph2;
+}
+
+void compressedFileRoundTrip() {
+	SkeletalGraph* graph = new SkeletalGraph();
+	GRfloat scale;
+	SkeletalGraph::import_from_file("grapholon/test.graph", graph, scale);
+
+	std::string filename = "graph1.txt.lz";
+	if (!graph->export_to_file(filename, scale, true)) {
+		std::cout << "could not export the graph to " << filename << std::endl;
+		delete graph;
+		return;
+	}
+
+	SkeletalGraph* graph2 = new SkeletalGraph();
+	GRfloat scale2;
+	SkeletalGraph::import_from_file(filename, graph2, scale2);
+
+	std::cout << "compressed text round trip : " << (sameGraphs(*graph, *graph2) && scale == scale2 ? "same graphs" : "DIFFERENT GRAPHS") << std::endl;
+
+	delete graph;
+	delete graph2;
+}
+
 int main()
 {
 